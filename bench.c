@@ -0,0 +1,372 @@
+// MIT License
+// Copyright (c) 2025 Lauri Lorenzo Fiestas
+// https://github.com/PrinssiFiestas/hexgame/blob/main/LICENSE.md
+
+// Benchmarks of the game engine and the parts of gpc.h it depends on, built by
+// make bench with the same flags as the game. Prints one CSV row per benchmark
+// to be compared between releases:
+//
+//     build,benchmark,iterations,samples,min_ns,p50_ns,p90_ns,p99_ns,max_ns
+//
+// A benchmark is a batch of iterations timed as a whole, so the clock is read
+// twice per batch, not per iteration. BENCH_WARMUPS batches are run first to
+// fault in memory and train caches and branch predictors, then BENCH_SAMPLES
+// batches are timed. Columns are nanoseconds per iteration over the samples.
+// Inputs come from fixed seeds, so every run and every build does the same work.
+//
+// Usage: hexgame-bench [BENCHMARK...]
+
+#define main hexgame_main // benchmarks need the internals, not the game
+#include "hexgame.c"
+#undef main
+
+#ifndef BENCH_BUILD
+#define BENCH_BUILD "unknown" // build configuration, first column of CSV
+#endif
+
+#define BENCH_WARMUPS 16
+#define BENCH_SAMPLES 256
+
+// --------------------------------
+// Runner
+
+typedef struct benchmark Benchmark;
+struct benchmark
+{
+    const char* name;
+    size_t      iterations; // per batch
+    int         arg;
+    void      (*setup)(const Benchmark*); // nullable, not timed, before every batch
+    void      (*batch)(const Benchmark*);
+};
+
+static volatile uint64_t bench_sink; // keeps results from being optimized away
+
+static int bench_compare(const void* _a, const void* _b)
+{
+    const double a = *(const double*)_a;
+    const double b = *(const double*)_b;
+    return (a > b) - (a < b);
+}
+
+// Nearest rank of sorted samples.
+static double bench_percentile(const double sorted[BENCH_SAMPLES], double fraction)
+{
+    size_t rank = fraction * BENCH_SAMPLES + .999999;
+    return sorted[gp_min(gp_max(rank, (size_t)1), (size_t)BENCH_SAMPLES) - 1];
+}
+
+static void bench_run(const Benchmark* bench)
+{
+    static double samples[BENCH_SAMPLES];
+    for (size_t i = 0; i < BENCH_WARMUPS + BENCH_SAMPLES; ++i) {
+        if (bench->setup != NULL)
+            bench->setup(bench);
+        const clock_ns_t start = clock_now();
+        bench->batch(bench);
+        const clock_ns_t end = clock_now();
+        if (i >= BENCH_WARMUPS)
+            samples[i - BENCH_WARMUPS] = 1e9 * clock_diff(end, start) / bench->iterations;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof samples[0], bench_compare);
+    printf("%s,%s,%zu,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+        BENCH_BUILD, bench->name, bench->iterations, BENCH_SAMPLES,
+        samples[0],
+        bench_percentile(samples, .50),
+        bench_percentile(samples, .90),
+        bench_percentile(samples, .99),
+        samples[BENCH_SAMPLES - 1]);
+    fflush(stdout);
+}
+
+// --------------------------------
+// Game Engine
+
+static GameRound     bench_round;
+static QuestionTable bench_questions;
+
+// Arg is bits, negative for adaptive questions.
+static void bench_round_setup(const Benchmark* bench)
+{
+    static const float weights[16] = { 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1 };
+    const unsigned bits = bench->arg < 0 ? -bench->arg : bench->arg;
+    bench_round = game_round_new(
+        BASE2, BASE16, bits, session_round_random_state(1, BASE2, BASE16),
+        &bench_questions, bench->arg < 0 ? weights : NULL);
+}
+
+// Every fourth answer is wrong, which is about what players do.
+static void bench_round_play(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i) {
+        const uint32_t left = game_round_next_question(&bench_round);
+        game_round_submit(&bench_round, i % 4 == 3 ? left ^ 1 : left, .5);
+    }
+    bench_sink += bench_round.score;
+}
+
+// --------------------------------
+// Numbers
+
+#define BENCH_NUMBERS 1024
+
+static uint32_t bench_numbers[BENCH_NUMBERS];
+static unsigned bench_number_bits[BENCH_NUMBERS];
+static char     bench_answers[BASE_LENGTH][BENCH_NUMBERS][NUMBER_BUFFER_SIZE];
+static size_t   bench_answer_lengths[BASE_LENGTH][BENCH_NUMBERS];
+
+// Questions of all widths, formatted like shown to players.
+static void bench_numbers_init(void)
+{
+    GPRandomState rs = gp_random_state(42);
+    for (size_t i = 0; i < BENCH_NUMBERS; ++i) {
+        bench_number_bits[i] = 4u << (i % 4);
+        bench_numbers[i]     = gp_random(&rs) & number_mask(bench_number_bits[i]);
+        for (base_t base = 0; base < BASE_LENGTH; ++base)
+            bench_answer_lengths[base][i] = format_number(
+                bench_answers[base][i], bench_numbers[i], base, bench_number_bits[i]);
+    }
+}
+
+static void bench_format_number(const Benchmark* bench)
+{
+    char buf[NUMBER_BUFFER_SIZE];
+    for (size_t i = 0; i < bench->iterations; ++i) {
+        const size_t j = i % BENCH_NUMBERS;
+        bench_sink += format_number(buf, bench_numbers[j], bench->arg, bench_number_bits[j]);
+    }
+}
+
+static void bench_parse_answer(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i) {
+        const size_t j = i % BENCH_NUMBERS;
+        bench_sink += parse_answer(
+            bench_answers[bench->arg][j], bench_answer_lengths[bench->arg][j], bench->arg);
+    }
+}
+
+// --------------------------------
+// Leaderboard
+
+static LeaderBoard bench_leaderboards[2]; // in memory and in file
+static char        bench_dir[4096];
+
+static void bench_leaderboard_init(void)
+{
+    leaderboard_open(&bench_leaderboards[0], NULL);
+    #if !_WIN32
+    const char* tmp = getenv("TMPDIR");
+    snprintf(bench_dir, sizeof bench_dir, "%s/hexgame-bench-XXXXXX", tmp != NULL ? tmp : "/tmp");
+    if (mkdtemp(bench_dir) == NULL) {
+        fprintf(stderr, "hexgame: cannot create %s: %s\n", bench_dir, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    leaderboard_open(&bench_leaderboards[1], bench_dir);
+    #else
+    leaderboard_open(&bench_leaderboards[1], NULL);
+    #endif
+}
+
+static void bench_leaderboard_delete(void)
+{
+    leaderboard_close(&bench_leaderboards[0]);
+    leaderboard_close(&bench_leaderboards[1]);
+    #if !_WIN32
+    const char* files[] = { "leaderboard.bin", "history.bin", "stats.bin", "schedule.bin" };
+    char path[4096 + 32];
+    for (size_t i = 0; i < sizeof files / sizeof files[0]; ++i) {
+        snprintf(path, sizeof path, "%s/%s", bench_dir, files[i]);
+        remove(path);
+    }
+    rmdir(bench_dir);
+    #endif
+}
+
+// Empties the round, so every insert of the batch makes it to the top.
+static void bench_leaderboard_setup(const Benchmark* bench)
+{
+    LeaderBoardSlot* slots = leaderboard_slots(bench_leaderboards[bench->arg].header, BASE2, BASE16);
+    memset(slots, 0, 2 * sizeof slots[0]);
+}
+
+// Arg 0 is in memory, 1 saves to leaderboard.bin.
+static void bench_leaderboard_insert(const Benchmark* bench)
+{
+    LeaderBoardEntry entry = { .name = "bench", .reaction_ms = le16(1500) };
+    for (size_t i = 0; i < bench->iterations; ++i) {
+        entry.timestamp = le64(i);
+        entry.score     = le16(i + 1);
+        bench_sink += leaderboard_insert(&bench_leaderboards[bench->arg], BASE2, BASE16, &entry);
+    }
+}
+
+// Opens and validates the files of leaderboard_save and reads every round.
+static void bench_leaderboard_load(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i) {
+        LeaderBoard lb;
+        leaderboard_open(&lb, bench_dir[0] != '\0' ? bench_dir : NULL);
+        for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+            for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+                if (lb.header->offsets[left_base][right_base] != 0)
+                    bench_sink += le32(leaderboard_round(&lb, left_base, right_base)->length);
+        leaderboard_close(&lb);
+    }
+}
+
+// --------------------------------
+// gpc.h
+
+#define BENCH_KEYS 1024
+
+static char       bench_keys[BENCH_KEYS][16]; // like names in analysis
+static GPHashMap* bench_map;      // filled by setup of put
+static GPHashMap* bench_full_map; // all keys
+static GPArena*   bench_arena;
+static FILE*      bench_null;
+static char       bench_utf8[4096];
+
+static void bench_gpc_init(void)
+{
+    GPRandomState rs = gp_random_state(7);
+    for (size_t i = 0; i < BENCH_KEYS; ++i)
+        snprintf(bench_keys[i], sizeof bench_keys[i], "player%08x", (unsigned)gp_random(&rs));
+    bench_full_map = gp_hash_map_new(gp_heap, &(GPMapInitializer){ .element_size = sizeof(size_t) });
+    for (size_t i = 0; i < BENCH_KEYS; ++i)
+        gp_hash_map_put(bench_full_map, bench_keys[i], sizeof bench_keys[i], &i);
+
+    bench_arena = gp_arena_new(NULL, 1 << 16);
+    #if _WIN32
+    bench_null  = fopen("NUL", "w");
+    #else
+    bench_null  = fopen("/dev/null", "w");
+    #endif
+    gp_assert(bench_null != NULL, strerror(errno));
+
+    // Names and messages are mostly ASCII with some Finnish and emoji.
+    const char pattern[] = "Pelaaja \xC3\x84\xC3\xB6 got 12 points \xF0\x9F\x8E\x89 ";
+    for (size_t i = 0; i < sizeof bench_utf8; ++i)
+        bench_utf8[i] = pattern[i % (sizeof pattern - 1)];
+}
+
+static void bench_gpc_delete(void)
+{
+    if (bench_map != NULL) // only if gp_hash_map_put was run
+        gp_hash_map_delete(bench_map);
+    gp_hash_map_delete(bench_full_map);
+    gp_arena_delete(bench_arena);
+    fclose(bench_null);
+}
+
+static void bench_bytes_println(const Benchmark* bench)
+{
+    char buf[128];
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += gp_bytes_n_println(buf, sizeof buf, "Got", i, "points in", "%.3f", i * .125, "s");
+}
+
+static void bench_file_println(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += gp_file_println(bench_null, "Got", i, "points in", "%.3f", i * .125, "s");
+}
+
+static void bench_hash_map_setup(const Benchmark* bench)
+{
+    (void)bench;
+    if (bench_map != NULL)
+        gp_hash_map_delete(bench_map);
+    bench_map = gp_hash_map_new(gp_heap, &(GPMapInitializer){ .element_size = sizeof(size_t) });
+}
+
+// Fresh map every batch, so growing is included.
+static void bench_hash_map_put(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += *(size_t*)gp_hash_map_put(bench_map, bench_keys[i % BENCH_KEYS], 16, &i);
+}
+
+static void bench_hash_map_get(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += *(size_t*)gp_hash_map_get(bench_full_map, bench_keys[i % BENCH_KEYS], 16);
+}
+
+static void bench_arena_setup(const Benchmark* bench)
+{
+    (void)bench;
+    gp_arena_reset(bench_arena);
+}
+
+// Sizes of lines and small strings.
+static void bench_arena_alloc(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += (uintptr_t)gp_mem_alloc(&bench_arena->base, 8 + i % 64);
+}
+
+// Arg is length in bytes, starting offset varies to cover all alignments.
+static void bench_codepoint_count(const Benchmark* bench)
+{
+    for (size_t i = 0; i < bench->iterations; ++i)
+        bench_sink += gp_bytes_codepoint_count(bench_utf8 + i % 64, bench->arg);
+}
+
+// --------------------------------
+// Main
+
+static const Benchmark benchmarks[] = {
+    { "round_uniform4",         1024,       4,      bench_round_setup,       bench_round_play          },
+    { "round_uniform32",        1024,       32,     bench_round_setup,       bench_round_play          },
+    { "round_adaptive4",        1024,       -4,     bench_round_setup,       bench_round_play          },
+    { "format_number_bin",      1024,       BASE2,  NULL,                    bench_format_number       },
+    { "format_number_dec",      1024,       BASE10, NULL,                    bench_format_number       },
+    { "format_number_hex",      1024,       BASE16, NULL,                    bench_format_number       },
+    { "parse_answer_bin",       1024,       BASE2,  NULL,                    bench_parse_answer        },
+    { "parse_answer_dec",       1024,       BASE10, NULL,                    bench_parse_answer        },
+    { "parse_answer_hex",       1024,       BASE16, NULL,                    bench_parse_answer        },
+    { "leaderboard_insert",     256,        0,      bench_leaderboard_setup, bench_leaderboard_insert  },
+    { "leaderboard_save",       16,         1,      bench_leaderboard_setup, bench_leaderboard_insert  },
+    { "leaderboard_load",       16,         0,      NULL,                    bench_leaderboard_load    },
+    { "gp_bytes_println",       1024,       0,      NULL,                    bench_bytes_println       },
+    { "gp_file_println",        1024,       0,      NULL,                    bench_file_println        },
+    { "gp_hash_map_put",        BENCH_KEYS, 0,      bench_hash_map_setup,    bench_hash_map_put        },
+    { "gp_hash_map_get",        BENCH_KEYS, 0,      NULL,                    bench_hash_map_get        },
+    { "gp_arena_alloc",         1024,       0,      bench_arena_setup,       bench_arena_alloc         },
+    { "gp_codepoint_count16",   1024,       16,     NULL,                    bench_codepoint_count     },
+    { "gp_codepoint_count4000", 64,         4000,   NULL,                    bench_codepoint_count     },
+};
+
+int main(int argc, char** argv)
+{
+    const size_t benchmarks_length = sizeof benchmarks / sizeof benchmarks[0];
+    for (int i = 1; i < argc; ++i) {
+        size_t j = 0;
+        while (j < benchmarks_length && strcmp(argv[i], benchmarks[j].name) != 0)
+            ++j;
+        if (j == benchmarks_length) {
+            fprintf(stderr, "hexgame: unknown benchmark %s, expected one of:\n", argv[i]);
+            for (j = 0; j < benchmarks_length; ++j)
+                fprintf(stderr, "    %s\n", benchmarks[j].name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    clock_init();
+    bench_numbers_init();
+    bench_leaderboard_init();
+    bench_gpc_init();
+
+    puts("build,benchmark,iterations,samples,min_ns,p50_ns,p90_ns,p99_ns,max_ns");
+    for (size_t i = 0; i < benchmarks_length; ++i) {
+        bool selected = argc == 1;
+        for (int j = 1; j < argc && ! selected; ++j)
+            selected = strcmp(argv[j], benchmarks[i].name) == 0;
+        if (selected)
+            bench_run(&benchmarks[i]);
+    }
+
+    bench_gpc_delete();
+    bench_leaderboard_delete();
+}
@@ -0,0 +1,204 @@
+// MIT License
+// Copyright (c) 2025 Lauri Lorenzo Fiestas
+// https://github.com/PrinssiFiestas/hexgame/blob/main/LICENSE.md
+
+// Checks that game() plays rounds without allocating or parsing format strings,
+// built and run by make check. Rounds are shortened and played for real from
+// scripted answers, once as lines from a pipe and once as keystrokes from a
+// pseudoterminal in raw mode, which is how they are typed in a terminal. Every
+// fourth question is answered wrong first and every eighth with an invalid
+// number before that, so all feedback gets drawn. Answers are typed with and
+// without 0x prefix and zero padding, so raw rounds must score like line rounds
+// or some answer got submitted before it was typed completely. Calls are
+// counted by wrapping the allocation and printf() family functions with macros
+// before including hexgame.c, and gp_mem_alloc() with the profiling hooks of
+// gpc.h. Exits with failure if a round called any of them.
+//
+// Usage: hexgame-check
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static size_t check_allocations; // malloc() family and gp_mem_alloc()
+static size_t check_formats;     // printf() family
+
+#define malloc(...)    (++check_allocations, malloc(__VA_ARGS__))
+#define calloc(...)    (++check_allocations, calloc(__VA_ARGS__))
+#define realloc(...)   (++check_allocations, realloc(__VA_ARGS__))
+#define printf(...)    (++check_formats, printf(__VA_ARGS__))
+#define fprintf(...)   (++check_formats, fprintf(__VA_ARGS__))
+#define sprintf(...)   (++check_formats, sprintf(__VA_ARGS__))
+#define snprintf(...)  (++check_formats, snprintf(__VA_ARGS__))
+#define vprintf(...)   (++check_formats, vprintf(__VA_ARGS__))
+#define vfprintf(...)  (++check_formats, vfprintf(__VA_ARGS__))
+#define vsprintf(...)  (++check_formats, vsprintf(__VA_ARGS__))
+#define vsnprintf(...) (++check_formats, vsnprintf(__VA_ARGS__))
+#define GP_PROFILE_BEGIN(ID) check_allocations += (ID) == GP_PROFILE_MEM_ALLOC
+#define GP_PROFILE_END(ID)
+
+#define ROUND_DURATION  1.
+#define ROUND_COUNTDOWN 1
+
+#define main hexgame_main // check needs the internals, not the game
+#include "hexgame.c"
+#undef main
+
+#if __linux__
+#include <pty.h>
+#elif !_WIN32
+#include <util.h>
+#endif
+
+#define CHECK_SEED      1234
+#define CHECK_QUESTIONS 64 // fits to terminal buffers
+
+typedef struct check_round
+{
+    base_t   left_base;
+    base_t   right_base;
+    unsigned bits;
+} CheckRound;
+
+static const CheckRound check_rounds[] = {
+    { BASE2,  BASE10, 4  },
+    { BASE16, BASE2,  32 },
+    { BASE10, BASE16, 8  },
+    { BASE2,  BASE16, 4  },
+};
+
+// Answers are typed as shown in questions, then without 0x prefix and then
+// also without leading zeros, by turns.
+static void check_append_answer(Line* line, uint32_t answer, const CheckRound* round, size_t i)
+{
+    char digits[NUMBER_BUFFER_SIZE];
+    size_t length = format_number(digits, answer, round->right_base, round->bits);
+    const char* typed = digits;
+    if (i % 3 != 0)
+        typed = answer_digits(digits, &length, round->right_base);
+    while (i % 3 == 2 && length > 1 && typed[0] == '0') {
+        ++typed;
+        --length;
+    }
+    line_append(line, typed, length);
+    line_append_literal(line, "\n");
+}
+
+// Answers to questions of a round like a player would type them.
+static size_t check_script(const CheckRound* round, char* script, size_t script_size)
+{
+    GameRound state = game_round_new(round->left_base, round->right_base, round->bits,
+        session_round_random_state(CHECK_SEED, round->left_base, round->right_base), NULL, NULL);
+    size_t length = 0;
+    for (size_t i = 0; i < CHECK_QUESTIONS; ++i) {
+        const uint32_t question = game_round_next_question(&state);
+        Line line = {0};
+        if (i % 8 == 7)
+            line_append_literal(&line, "?\n");
+        if (i % 4 == 3)
+            check_append_answer(&line, question ^ 1, round, i);
+        check_append_answer(&line, question, round, i);
+        gp_assert(length + line.length <= script_size);
+        memcpy(script + length, line.buffer, line.length);
+        length += line.length;
+    }
+    return length;
+}
+
+int main(void)
+{
+    #if _WIN32
+    fprintf(stderr, "hexgame: check needs pipes and pseudoterminals.\n");
+    return EXIT_FAILURE;
+    #else
+    clock_init();
+    char dir[4096];
+    const char* tmp = getenv("TMPDIR");
+    snprintf(dir, sizeof dir, "%s/hexgame-check-XXXXXX", tmp != NULL ? tmp : "/tmp");
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "hexgame: cannot create %s: %s\n", dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int terminal = -1;
+    int player   = -1;
+    openpty(&terminal, &player, NULL, NULL, NULL);
+    const int original_stdin = dup(STDIN_FILENO);
+    const int screen         = open("/dev/null", O_WRONLY);
+    if (player == -1 || original_stdin == -1 || screen == -1 || dup2(player, STDIN_FILENO) == -1) {
+        fprintf(stderr, "hexgame: cannot open pseudoterminal: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    Renderer renderer;
+    renderer_init(&renderer, screen);
+    Live live;
+    live_open(&live, dir, "check");
+    static Stats stats;
+    bool failed = false;
+    size_t round_number = 0;
+    size_t line_scores[sizeof check_rounds / sizeof check_rounds[0]];
+    for (int raw = 0; raw <= 1; ++raw)
+    {
+        for (size_t i = 0; i < sizeof check_rounds / sizeof check_rounds[0]; ++i, ++round_number)
+        {
+            const CheckRound* round = &check_rounds[i];
+            static char script[16384];
+            const size_t script_length = check_script(round, script, sizeof script);
+
+            int pipe_fds[2] = { -1, -1 };
+            Input input;
+            if (raw) { // written to raw terminal, so not echoed nor buffered by lines
+                input_init(&input, STDIN_FILENO);
+                gp_assert(input_raw_mode(&input, true));
+                gp_assert(write(terminal, script, script_length) == (ssize_t)script_length, strerror(errno));
+            } else {
+                gp_assert(pipe(pipe_fds) != -1, strerror(errno));
+                input_init(&input, pipe_fds[0]);
+                gp_assert(write(pipe_fds[1], script, script_length) == (ssize_t)script_length, strerror(errno));
+            }
+            EventLog events;
+            event_log_open(&events, dir, "check", CHECK_SEED, round->bits);
+
+            const size_t allocations = check_allocations;
+            const size_t formats     = check_formats;
+            uint16_t reaction_ms;
+            const size_t score = game(round_number, round->left_base, round->right_base, round->bits,
+                &renderer, &input, NULL, &events, CHECK_SEED, NULL, &stats, &live, &reaction_ms);
+            const size_t round_allocations = check_allocations - allocations;
+            const size_t round_formats     = check_formats     - formats;
+
+            event_log_close(&events, score, "check");
+            if (raw)
+                input_raw_mode(&input, false);
+            else {
+                close(pipe_fds[0]);
+                close(pipe_fds[1]);
+            }
+
+            if ( ! raw)
+                line_scores[i] = score;
+            const bool passed = round_allocations == 0 && round_formats == 0 && score > 0 && score == line_scores[i];
+            failed |= ! passed;
+            printf("hexgame: check %s: %s round %s with %u bits scored %zu, %zu allocations, %zu format calls\n",
+                passed ? "passed" : "failed", raw ? "raw" : "line",
+                round_names[round->left_base][round->right_base], round->bits,
+                score, round_allocations, round_formats);
+        }
+    }
+
+    live_close(&live);
+    renderer_delete(&renderer);
+    dup2(original_stdin, STDIN_FILENO);
+    close(original_stdin);
+    close(player);
+    close(terminal);
+    close(screen);
+    const char* files[] = { "live.bin", "events.bin" };
+    char path[4096 + 32];
+    for (size_t i = 0; i < sizeof files / sizeof files[0]; ++i) {
+        snprintf(path, sizeof path, "%s/%s", dir, files[i]);
+        remove(path);
+    }
+    rmdir(dir);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    #endif
+}
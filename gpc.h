@@ -519,6 +519,25 @@
 
 #endif // compilers (not) supporting long double
 
+// ----------------------------------------------------------------------------
+// Profiling Hooks
+
+// Hot functions are bracketed with GP_PROFILE_BEGIN(id) and GP_PROFILE_END(id)
+// in the same scope. Can be globally overridden to count or time calls, BEGIN
+// may declare variables for END. Expand to nothing by default.
+typedef enum gp_profile_id
+{
+    GP_PROFILE_MEM_ALLOC,            // gp_mem_alloc()
+    GP_PROFILE_ARENA_NODE_NEW_ALLOC, // arena out of memory, new node allocated
+    GP_PROFILE_MAP_PUT,              // gp_map_put(), also gp_hash_map_put()
+    GP_PROFILE_LENGTH
+} GPProfileId;
+
+#ifndef GP_PROFILE_BEGIN
+#  define GP_PROFILE_BEGIN(ID)
+#  define GP_PROFILE_END(ID)
+#endif
+
 #endif // GP_ATTRIBUTES_INCLUDED
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -2631,7 +2650,10 @@ static inline void* gp_mem_alloc(
     size_t size)
 {
     gp_db_assert(size <= PTRDIFF_MAX, "Possibly negative allocation detected.");
-    return allocator->alloc(allocator, size, GP_ALLOC_ALIGNMENT);
+    GP_PROFILE_BEGIN(GP_PROFILE_MEM_ALLOC);
+    void* block = allocator->alloc(allocator, size, GP_ALLOC_ALIGNMENT);
+    GP_PROFILE_END(GP_PROFILE_MEM_ALLOC);
+    return block;
 }
 
 GP_NONNULL_ARGS_AND_RETURN GP_NODISCARD GP_ATTRIB_ALLOC_ALIGN(3)
@@ -17141,13 +17163,16 @@ void* gp_map_put(
     GPUInt128 key,
     const void* value)
 {
-    return gp_map_put_elem(
+    GP_PROFILE_BEGIN(GP_PROFILE_MAP_PUT);
+    void* element = gp_map_put_elem(
         map->allocator,
         (GPSlot*)(map + 1),
         map->length,
         key,
         value,
         map->element_size);
+    GP_PROFILE_END(GP_PROFILE_MAP_PUT);
+    return element;
 }
 
 static void* gp_map_get_elem(
@@ -18301,6 +18326,7 @@ static void* gp_arena_node_new_alloc(
     size_t size,
     size_t alignment)
 {
+    GP_PROFILE_BEGIN(GP_PROFILE_ARENA_NODE_NEW_ALLOC);
     GPArenaNode* new_node = gp_mem_alloc(allocator,
         gp_round_to_aligned(sizeof(GPArenaNode), alignment)
         + gp_max(new_cap, size + GP_POISON_BOUNDARY_SIZE)
@@ -18320,6 +18346,7 @@ static void* gp_arena_node_new_alloc(
     ASAN_POISON_MEMORY_REGION(new_node + 1,
         gp_round_to_aligned((uintptr_t)(new_node + 1), alignment) - (uintptr_t)(new_node + 1));
 
+    GP_PROFILE_END(GP_PROFILE_ARENA_NODE_NEW_ALLOC);
     return block;
 }
 
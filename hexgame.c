@@ -2,6 +2,15 @@
 // Copyright (c) 2025 Lauri Lorenzo Fiestas
 // https://github.com/PrinssiFiestas/hexgame/blob/main/LICENSE.md
 
+// Allocations and maps of gpc.h are counted too, see Counters.
+#if HEXGAME_COUNTERS
+#include <stdint.h>
+#define GP_PROFILE_BEGIN(ID) const uint64_t gp_profile_start_##ID = counter_ticks()
+#define GP_PROFILE_END(ID)   counter_add_gpc(ID, gp_profile_start_##ID)
+static uint64_t counter_ticks(void);
+static void     counter_add_gpc(unsigned id, uint64_t start);
+#endif
+
 #define GPC_IMPLEMENTATION
 #include "gpc.h"
 #include <sys/types.h>
@@ -10,8 +19,29 @@
 #include <unistd.h>
 #include <errno.h>
 #include <ctype.h>
-#include <stdarg.h>
 #include <time.h>
+#if !_WIN32
+#include <sys/mman.h>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/uio.h>
+#endif
+#if (__x86_64__ || __i386__) && __GNUC__
+#include <cpuid.h>
+#endif
+#if __linux__
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <stdarg.h>
+#endif
+#if _WIN32
+#include <io.h>
+#endif
 
 typedef enum base
 {
@@ -24,11 +54,16 @@ typedef enum base
 // Probably no reason to make any bigger, but here we go if needed.
 typedef uint16_t score_t;
 
+// Entries, history records and leaderboard.bin are read and written in place,
+// so they have fixed size little-endian fields and no implicit padding. Read and
+// write integer fields with le16(), le32() and le64().
 typedef struct leaderboard_entry
 {
-    char    name[16];
-    time_t  timestamp;
-    score_t score;
+    char     name[16];
+    int64_t  timestamp;
+    score_t  score;
+    uint16_t reaction_ms; // mean time to correct answer, 0 if unknown
+    uint32_t seed;        // of session, 0 if unknown
 } LeaderBoardEntry;
 
 typedef struct high_score_position
@@ -38,6 +73,62 @@ typedef struct high_score_position
     size_t position;
 } HighScorePosition;
 
+// Every result ever played is appended to history.bin. leaderboard.bin only
+// indexes the best LEADERBOARD_MAX_LENGTH of each 4 bit round and can be
+// rebuilt from history.
+typedef struct history_record
+{
+    uint8_t          version; // HISTORY_VERSION
+    uint8_t          left_base;
+    uint8_t          right_base;
+    uint8_t          bits; // 0 in records from before other widths than 4
+    uint8_t          reserved[4];
+    LeaderBoardEntry entry;
+} HistoryRecord;
+
+#define HISTORY_VERSION 2 // 1 had native time_t and byte order
+
+#define LEADERBOARD_MAX_LENGTH 10
+
+// Each round has two of these in leaderboard.bin, the current one is the valid
+// one with larger sequence. Commits write the other one, so a crash in the
+// middle of a commit always leaves the old contents intact.
+typedef struct leaderboard_slot
+{
+    uint64_t         sequence; // 0 for never written
+    uint32_t         checksum;
+    uint32_t         length;
+    LeaderBoardEntry entries[LEADERBOARD_MAX_LENGTH];
+} LeaderBoardSlot;
+
+#define LEADERBOARD_MAGIC   "HEXGAME" // 8 bytes with null terminator
+#define LEADERBOARD_VERSION 2 // 1 had native time_t and byte order
+
+typedef struct leaderboard_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t max_length;
+    uint32_t slot_size;
+    uint64_t offsets[BASE_LENGTH][BASE_LENGTH]; // of slot pairs, 0 for no round
+} LeaderBoardHeader;
+
+static_assert(sizeof(LeaderBoardEntry)  == 32,  "leaderboard.bin layout must not depend on platform.");
+static_assert(sizeof(HistoryRecord)     == 40,  "history.bin layout must not depend on platform.");
+static_assert(sizeof(LeaderBoardSlot)   == 336, "leaderboard.bin layout must not depend on platform.");
+static_assert(sizeof(LeaderBoardHeader) == 96,  "leaderboard.bin layout must not depend on platform.");
+
+typedef struct leaderboard
+{
+    LeaderBoardHeader* header;     // whole file mapped
+    size_t             size;
+    int                fd;         // -1 if not backed by file
+    int                history_fd;  // -1 if not backed by file
+    int                stats_fd;    // -1 if not backed by file
+    int                schedule_fd; // -1 if not backed by file
+} LeaderBoard;
+
 // -----------------------------
 // ▘|▝|▀|▖|▌|▞|▛|▗|▚|▐|▜|▄|▙|▟|█
 // -----------------------------
@@ -50,291 +141,5317 @@ static const char* header = GP_MAGENTA       "\n"
 "█  █ █▄▄▄ ▟▘  ▝▙   ▜▙▄▄▄▛ █   █ █  ▝▘  █ █▄▄▄\n"
 "▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄▄" GP_RESET_TERMINAL "\n";
 
-#define ROUND_DURATION 30. // seconds
+// Shorter in make check, which plays rounds for real.
+#ifndef ROUND_DURATION
+#define ROUND_DURATION 30. // seconds
+#endif
+#ifndef ROUND_COUNTDOWN
+#define ROUND_COUNTDOWN 5 // seconds
+#endif
+
+static const char* base_lowercase[BASE_LENGTH] = {
+    [BASE2]  = "binary",
+    [BASE10] = "decimal",
+    [BASE16] = "hexadecimal"
+};
+
+static const char* base_titlecase[BASE_LENGTH] = {
+    [BASE2]  = "Binary",
+    [BASE10] = "Decimal",
+    [BASE16] = "Hexadecimal"
+};
+
+#define SCORE_FIELD_WIDTH    8
+#define REACTION_FIELD_WIDTH 8
+
+#define BASE_COMBINATIONS (BASE_LENGTH * (BASE_LENGTH - 1)) // distinct
+
+static const char* usage =
+    "hexgame: usage:\n"
+    "    hexgame                           play\n"
+    "    hexgame --record FILE             play and record answers to FILE\n"
+    "    hexgame --bits N                  play with N bit numbers, 4 (default),\n"
+    "                                      8, 16 or 32, only 4 bit results go to\n"
+    "                                      leaderboard\n"
+    "    hexgame --seed S                  play session S, where questions only\n"
+    "                                      depend on S, for tournaments\n"
+    "    hexgame leaderboard [--round R] [--since DATE] [--name N] [--top N]\n"
+    "                        [--format text|csv|json] [--global]\n"
+    "                                      show leaderboard, R like bin2hex or\n"
+    "                                      total and DATE like 2025-01-31 or\n"
+    "                                      2025-01-31T18:00, top 10 by default,\n"
+    "                                      global merges top 10 of all users\n"
+    "    hexgame stats                     show accuracy and reaction times of\n"
+    "                                      every question\n"
+    "    hexgame replay [FILE] [--name N]  play recorded answers headless, submit\n"
+    "                                      results as N if given\n"
+    "    hexgame verify S [FILE] [--bits N] [--questions N] [--answers]\n"
+    "                                      print first N questions (16 by\n"
+    "                                      default) of session S or check that\n"
+    "                                      FILE recorded session S and score it,\n"
+    "                                      answers prints a recording answering\n"
+    "                                      the questions for replay\n"
+    "    hexgame analyze [FILE...] [--threads N]\n"
+    "                                      show stats of players and questions in\n"
+    "                                      event logs, ~/.hexgame/events.bin by\n"
+    "                                      default\n"
+    "    hexgame serve [SOCKET]            host games on Unix socket, defaults to\n"
+    "                                      ~/.hexgame/server.sock\n"
+    "    hexgame client [SOCKET] [--sessions N] [--think SECONDS] [--name N]\n"
+    "                                      play N sessions against server\n"
+    "    hexgame ... --stats               with any of the above, print counters\n"
+    "                                      to stderr at exit, needs a build with\n"
+    "                                      -DHEXGAME_COUNTERS (make counters)";
+
+// --------------------------------
+// Clock
+//
+// Monotonic nanoseconds that don't jump with NTP or settimeofday(). On x86 with
+// invariant TSC, clock_init() calibrates rdtsc against CLOCK_MONOTONIC, after
+// which reading the clock is a single instruction and a multiply. Either way
+// times stay in the CLOCK_MONOTONIC domain, so they can be given to the kernel
+// as absolute deadlines.
+
+typedef uint64_t clock_ns_t;
+
+#define CLOCK_NS_PER_SECOND 1000000000ull
+
+#if (__x86_64__ || __i386__) && __GNUC__ && !defined(HEXGAME_NO_TSC)
+#define CLOCK_HAS_TSC 1
+#else
+#define CLOCK_HAS_TSC 0
+#endif
+
+static struct clock_tsc
+{
+    bool       enabled;
+    uint64_t   base;  // ticks at calibration
+    clock_ns_t base_ns;
+    uint64_t   mult;  // nanoseconds per tick times 2^32
+} clock_tsc;
+
+static clock_ns_t clock_monotonic(void)
+{
+    struct timespec t;
+    gp_assert(clock_gettime(CLOCK_MONOTONIC, &t) != -1, strerror(errno));
+    return t.tv_sec * CLOCK_NS_PER_SECOND + t.tv_nsec;
+}
+
+static clock_ns_t clock_now(void)
+{
+    #if CLOCK_HAS_TSC
+    if (clock_tsc.enabled) {
+        // Split to high and low halves to multiply without 128-bit math.
+        uint64_t ticks = __builtin_ia32_rdtsc() - clock_tsc.base;
+        return clock_tsc.base_ns
+            + (ticks >> 32) * clock_tsc.mult
+            + (((ticks & 0xFFFFFFFF) * clock_tsc.mult) >> 32);
+    }
+    #endif
+    return clock_monotonic();
+}
+
+// Seconds from b to a, negative if a is before b.
+static double clock_diff(clock_ns_t a, clock_ns_t b)
+{
+    return (double)(int64_t)(a - b) / CLOCK_NS_PER_SECOND;
+}
+
+static clock_ns_t clock_add(clock_ns_t t, double seconds)
+{
+    return t + (int64_t)(seconds * CLOCK_NS_PER_SECOND + (seconds < 0. ? -.5 : .5));
+}
+
+static struct timespec clock_timespec(clock_ns_t t)
+{
+    return (struct timespec){ .tv_sec = t / CLOCK_NS_PER_SECOND, .tv_nsec = t % CLOCK_NS_PER_SECOND };
+}
+
+// Enables the TSC fast path if the counter runs at constant rate regardless of
+// power states. Takes a few milliseconds.
+static void clock_init(void)
+{
+    #if CLOCK_HAS_TSC
+    unsigned eax, ebx, ecx, edx;
+    if ( ! __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || ! (edx & (1u << 8)))
+        return;
+
+    // Tick reads are bracketed by clock reads to bound the error.
+    clock_ns_t ns0 = clock_monotonic();
+    uint64_t   t0  = __builtin_ia32_rdtsc();
+    clock_ns_t ns1 = clock_monotonic();
+    struct timespec calibration = { .tv_nsec = 5000000 };
+    while (nanosleep(&calibration, &calibration) == -1 && errno == EINTR)
+        ;
+    clock_ns_t ns2 = clock_monotonic();
+    uint64_t   t1  = __builtin_ia32_rdtsc();
+    clock_ns_t ns3 = clock_monotonic();
+
+    const double ns  = ((ns2 + ns3)/2 - (ns0 + ns1)/2);
+    const double tsc = t1 - t0;
+    if (tsc <= ns / 10.) // slower than 100 MHz, something is off
+        return;
+    clock_tsc.mult    = ns / tsc * 4294967296. + .5;
+    clock_tsc.base    = t1;
+    clock_tsc.base_ns = (ns2 + ns3)/2;
+    clock_tsc.enabled = true;
+    #endif
+}
+
+// --------------------------------
+// Counters
+//
+// Optional instrumentation compiled in with -DHEXGAME_COUNTERS, see make
+// counters. Every thread counts calls and cycles, or nanoseconds without TSC,
+// to its own block, so a count is reading the clock and two stores to memory
+// no other thread writes. With --stats, sums of all threads are printed to
+// stderr at exit. Compiled out, the macros expand to nothing.
+
+typedef enum counter
+{
+    COUNTER_GAME_COUNTDOWN,
+    COUNTER_GAME_QUESTION,
+    COUNTER_GAME_ANSWER,   // question shown until answered, mostly waiting
+    COUNTER_GAME_SUBMIT,
+    COUNTER_GAME_FEEDBACK,
+    COUNTER_GAME_ROUND_END,
+    COUNTER_GAME_LATE,     // deadline until round actually ended
+    COUNTER_READ_INPUT,
+    COUNTER_LEADERBOARD_OPEN,
+    COUNTER_LEADERBOARD_LOCK,
+    COUNTER_LEADERBOARD_INSERT,
+    COUNTER_LEADERBOARD_SYNC,
+    COUNTER_LEADERBOARD_HISTORY,
+    COUNTER_LEADERBOARD_STATE, // stats.bin and schedule.bin
+    COUNTER_GP_MEM_ALLOC,      // gpc.h in order of GPProfileId
+    COUNTER_GP_ARENA_NODE_NEW_ALLOC,
+    COUNTER_GP_MAP_PUT,
+    COUNTER_LENGTH
+} Counter;
+
+#if HEXGAME_COUNTERS
+
+static_assert(COUNTER_LENGTH - COUNTER_GP_MEM_ALLOC == GP_PROFILE_LENGTH, "Count every GPProfileId.");
+
+static const char* counter_names[COUNTER_LENGTH] = {
+    [COUNTER_GAME_COUNTDOWN]          = "game countdown",
+    [COUNTER_GAME_QUESTION]           = "game question",
+    [COUNTER_GAME_ANSWER]             = "game answer",
+    [COUNTER_GAME_SUBMIT]             = "game submit",
+    [COUNTER_GAME_FEEDBACK]           = "game feedback",
+    [COUNTER_GAME_ROUND_END]          = "game round end",
+    [COUNTER_GAME_LATE]               = "game past deadline",
+    [COUNTER_READ_INPUT]              = "read_input",
+    [COUNTER_LEADERBOARD_OPEN]        = "leaderboard open",
+    [COUNTER_LEADERBOARD_LOCK]        = "leaderboard lock",
+    [COUNTER_LEADERBOARD_INSERT]      = "leaderboard insert",
+    [COUNTER_LEADERBOARD_SYNC]        = "leaderboard sync",
+    [COUNTER_LEADERBOARD_HISTORY]     = "leaderboard history",
+    [COUNTER_LEADERBOARD_STATE]       = "leaderboard state",
+    [COUNTER_GP_MEM_ALLOC]            = "gp_mem_alloc",
+    [COUNTER_GP_ARENA_NODE_NEW_ALLOC] = "gp_arena_node_new_alloc",
+    [COUNTER_GP_MAP_PUT]              = "gp_map_put",
+};
+
+typedef struct counters Counters;
+struct counters
+{
+    uint64_t  calls[COUNTER_LENGTH];
+    uint64_t  ticks[COUNTER_LENGTH];
+    Counters* next; // of all threads
+};
+
+static Counters*               counters_threads; // never freed, read at exit
+static _Thread_local Counters* counters_local;
+
+static uint64_t counter_ticks(void)
+{
+    #if CLOCK_HAS_TSC
+    return __builtin_ia32_rdtsc();
+    #else
+    return clock_monotonic();
+    #endif
+}
+
+// Not allocated with gp_mem_alloc(), which is counted.
+static Counters* counters_thread_new(void)
+{
+    Counters* counters = calloc(1, sizeof*counters);
+    gp_assert(counters != NULL);
+    counters->next = __atomic_load_n(&counters_threads, __ATOMIC_RELAXED);
+    while ( ! __atomic_compare_exchange_n(
+        &counters_threads, &counters->next, counters, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    return counters_local = counters;
+}
+
+// Stores are atomic only to let counters of running threads be read, they
+// compile to plain moves.
+static void counter_add(Counter counter, uint64_t start)
+{
+    const uint64_t end = counter_ticks();
+    Counters* counters = counters_local != NULL ? counters_local : counters_thread_new();
+    __atomic_store_n(&counters->calls[counter], counters->calls[counter] + 1,           __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->ticks[counter], counters->ticks[counter] + end - start, __ATOMIC_RELAXED);
+}
+
+static void counter_add_gpc(unsigned id, uint64_t start)
+{
+    counter_add(COUNTER_GP_MEM_ALLOC + id, start);
+}
+
+static uint64_t counter_ticks_ago(double seconds)
+{
+    #if CLOCK_HAS_TSC
+    const double ticks_per_ns = clock_tsc.enabled ? 4294967296. / clock_tsc.mult : 0.;
+    #else
+    const double ticks_per_ns = 1.;
+    #endif
+    return counter_ticks() - (uint64_t)(1e9 * seconds * ticks_per_ns);
+}
+
+typedef struct counter_scope
+{
+    Counter  counter;
+    uint64_t start;
+} CounterScope;
+
+static void counter_scope_end(const CounterScope* scope)
+{
+    counter_add(scope->counter, scope->start);
+}
+
+#define COUNTER_BEGIN(C) const uint64_t counter_start_##C = counter_ticks()
+#define COUNTER_END(C)   counter_add(C, counter_start_##C)
+// Counts from SECONDS ago until now.
+#define COUNTER_SINCE(C, SECONDS) counter_add(C, counter_ticks_ago(SECONDS))
+// Counts until the end of enclosing block, early returns included.
+#define COUNTER_SCOPE(C) \
+    __attribute__((cleanup(counter_scope_end))) const CounterScope counter_scope_##C = { C, counter_ticks() }
+
+// Cycles are only known with TSC and nanoseconds of cycles only if TSC is
+// invariant.
+static void counters_print(void)
+{
+    uint64_t calls[COUNTER_LENGTH] = {0};
+    uint64_t ticks[COUNTER_LENGTH] = {0};
+    size_t   threads = 0;
+    for (const Counters* counters = __atomic_load_n(&counters_threads, __ATOMIC_ACQUIRE);
+        counters != NULL;
+        counters = counters->next, ++threads)
+    {
+        for (size_t i = 0; i < COUNTER_LENGTH; ++i) {
+            calls[i] += __atomic_load_n(&counters->calls[i], __ATOMIC_RELAXED);
+            ticks[i] += __atomic_load_n(&counters->ticks[i], __ATOMIC_RELAXED);
+        }
+    }
+    const double ns_per_tick = ! CLOCK_HAS_TSC ? 1. : clock_tsc.enabled ? clock_tsc.mult / 4294967296. : 0.;
+
+    fprintf(stderr, "hexgame: counters of %zu threads\n", threads);
+    fprintf(stderr, "%-24s %12s %12s %12s %12s\n", "counter", "calls", "total ms", "mean ns", "mean cycles");
+    for (size_t i = 0; i < COUNTER_LENGTH; ++i) {
+        char total_ms[32] = "-";
+        char mean_ns[32] = "-";
+        char mean_cycles[32] = "-";
+        if (calls[i] != 0 && ns_per_tick != 0.) {
+            snprintf(total_ms, sizeof total_ms, "%.3f", 1e-6 * ns_per_tick * ticks[i]);
+            snprintf(mean_ns,  sizeof mean_ns,  "%.1f", ns_per_tick * ticks[i] / calls[i]);
+        }
+        if (calls[i] != 0 && CLOCK_HAS_TSC)
+            snprintf(mean_cycles, sizeof mean_cycles, "%.1f", (double)ticks[i] / calls[i]);
+        fprintf(stderr, "%-24s %12llu %12s %12s %12s\n",
+            counter_names[i], (unsigned long long)calls[i], total_ms, mean_ns, mean_cycles);
+    }
+}
+
+#else // compiled out
+
+#define COUNTER_BEGIN(C)
+#define COUNTER_END(C)
+#define COUNTER_SINCE(C, SECONDS)
+#define COUNTER_SCOPE(C)
+
+#endif // HEXGAME_COUNTERS
+
+// --------------------------------
+// Timer
+//
+// Absolute deadlines on the monotonic clock. Sleeping and waiting for input
+// block in the kernel until the deadline instead of polling the clock.
+
+typedef struct timer
+{
+    clock_ns_t start;
+    clock_ns_t deadline;
+} Timer;
+
+static Timer timer_new(double seconds)
+{
+    clock_ns_t now = clock_now();
+    return (Timer){ now, clock_add(now, seconds) };
+}
+
+// Moves deadline further from the previous one instead of from now, so
+// repeated sleeps don't accumulate drift.
+static void timer_extend(Timer* timer, double seconds)
+{
+    timer->deadline = clock_add(timer->deadline, seconds);
+}
+
+static double timer_elapsed(const Timer* timer)
+{
+    return clock_diff(clock_now(), timer->start);
+}
+
+static double timer_remaining(const Timer* timer)
+{
+    return clock_diff(timer->deadline, clock_now());
+}
+
+static bool timer_expired(const Timer* timer)
+{
+    return (int64_t)(clock_now() - timer->deadline) >= 0;
+}
+
+static void timer_sleep(const Timer* timer)
+{
+    #if _WIN32
+    double remaining = timer_remaining(timer);
+    if (remaining > 0.)
+        Sleep(remaining * 1000. + 1.);
+    #else
+    int error;
+    const struct timespec deadline = clock_timespec(timer->deadline);
+    while ((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)) == EINTR)
+        ;
+    gp_assert(error == 0, strerror(error));
+    #endif
+}
+
+// Blocks until fd has input or timer expires. Returns false if expired. On
+// Linux timerfd wakes us up at the exact deadline, elsewhere poll() timeouts
+// are rounded up to milliseconds. The kernel has the final say on expiring, so
+// TSC calibration error can't make us spin around the deadline.
+static bool timer_wait_input(const Timer* timer, int fd)
+{
+    #if __linux__
+    int deadline_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (deadline_fd != -1 && timerfd_settime(deadline_fd, TFD_TIMER_ABSTIME,
+        &(struct itimerspec){ .it_value = clock_timespec(timer->deadline) }, NULL) == -1)
+    {
+        close(deadline_fd);
+        deadline_fd = -1;
+    }
+    #else
+    int deadline_fd = -1;
+    #endif
+
+    double remaining;
+    while ((remaining = timer_remaining(timer)) > 0.)
+    {
+        int timeout_ms = deadline_fd != -1 ? -1 : remaining * 1000. + 1.; // never wake early
+        #if _WIN32
+        if (WaitForSingleObject((HANDLE)_get_osfhandle(fd), timeout_ms) != WAIT_TIMEOUT)
+            return true;
+        #else
+        struct pollfd pfds[] = {
+            { .fd = fd,          .events = POLLIN },
+            { .fd = deadline_fd, .events = POLLIN }, // ignored if -1
+        };
+        int result = poll(pfds, 2, timeout_ms);
+        if (result > 0 && pfds[0].revents != 0) {
+            if (deadline_fd != -1)
+                close(deadline_fd);
+            return true;
+        }
+        if (result > 0 && pfds[1].revents != 0)
+            break;
+        if (result == -1 && errno != EINTR) { // let caller do blocking read then
+            fprintf(stderr, "hexgame: poll() failed: %s\n", strerror(errno));
+            if (deadline_fd != -1)
+                close(deadline_fd);
+            return true;
+        }
+        #endif
+    }
+    if (deadline_fd != -1)
+        close(deadline_fd);
+    return false;
+}
+
+// --------------------------------
+// Numbers
+//
+// Questions are 4, 8, 16 or 32 bits wide. Formatting copies digits from tables
+// a byte or two decimal digits at a time and parsing converts 8 characters at
+// once in a uint64_t, so neither loops over single digits.
+
+#define NUMBER_BUFFER_SIZE 40         // 32 binary digits and NUL
+#define NUMBER_INVALID     UINT64_MAX // parse result that never matches a question
+
+#define BIN1(P) P"0" P"1"
+#define BIN2(P) BIN1(P"0") BIN1(P"1")
+#define BIN3(P) BIN2(P"0") BIN2(P"1")
+#define BIN4(P) BIN3(P"0") BIN3(P"1")
+#define BIN5(P) BIN4(P"0") BIN4(P"1")
+#define BIN6(P) BIN5(P"0") BIN5(P"1")
+#define BIN7(P) BIN6(P"0") BIN6(P"1")
+#define BIN8(P) BIN7(P"0") BIN7(P"1")
+#define HEX1(P) P"0" P"1" P"2" P"3" P"4" P"5" P"6" P"7" P"8" P"9" P"A" P"B" P"C" P"D" P"E" P"F"
+#define DEC1(P) P"0" P"1" P"2" P"3" P"4" P"5" P"6" P"7" P"8" P"9"
+
+static const char binary_digits[256 * 8 + 1] = BIN8("");
+static const char hex_digits[256 * 2 + 1] =
+    HEX1("0") HEX1("1") HEX1("2") HEX1("3") HEX1("4") HEX1("5") HEX1("6") HEX1("7")
+    HEX1("8") HEX1("9") HEX1("A") HEX1("B") HEX1("C") HEX1("D") HEX1("E") HEX1("F");
+static const char decimal_digits[100 * 2 + 1] =
+    DEC1("0") DEC1("1") DEC1("2") DEC1("3") DEC1("4") DEC1("5") DEC1("6") DEC1("7") DEC1("8") DEC1("9");
+
+static const uint32_t powers_of_ten[10] = { // except first, see number_digits()
+    0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static uint32_t number_mask(unsigned bits)
+{
+    return bits >= 32 ? UINT32_MAX : (UINT32_C(1) << bits) - 1;
+}
+
+// Significant digits, 1 for 0.
+static size_t number_digits(uint32_t u, base_t base)
+{
+    const size_t bit_length = 32 - __builtin_clz(u | 1);
+    switch (base) {
+    case BASE2:  return bit_length;
+    case BASE16: return (bit_length + 3) / 4;
+    case BASE10: {
+        const size_t guess = bit_length * 1233 >> 12; // log10(2) ~ 1233/4096
+        return guess + 1 - (u < powers_of_ten[guess]);
+    }
+    default: __builtin_unreachable();
+    }
+}
+
+// Length of formatted questions of a width, excluding NUL.
+static size_t number_width(base_t base, unsigned bits)
+{
+    switch (base) {
+    case BASE2:  return bits;
+    case BASE10: return number_digits(number_mask(bits), BASE10);
+    case BASE16: return 2 + bits / 4;
+    default: __builtin_unreachable();
+    }
+}
+
+// Question as shown to user: binary and hexadecimal padded to bits with zeros,
+// decimal without padding. Returns length.
+static size_t format_number(char buf[NUMBER_BUFFER_SIZE], uint32_t u, base_t base, unsigned bits)
+{
+    gp_assert(u <= number_mask(bits), u, bits);
+    size_t length = 0;
+    switch (base) {
+    case BASE2:
+        if (bits == 4) {
+            memcpy(buf, &binary_digits[8 * u + 4], 4);
+            length = 4;
+        } else for (; length < bits; length += 8)
+            memcpy(&buf[length], &binary_digits[8 * ((u >> (bits - 8 - length)) & 0xFF)], 8);
+        break;
+
+    case BASE16:
+        buf[length++] = '0';
+        buf[length++] = 'x';
+        if (bits == 4)
+            buf[length++] = hex_digits[2 * u + 1];
+        else for (size_t shift = bits; shift != 0; shift -= 8, length += 2)
+            memcpy(&buf[length], &hex_digits[2 * ((u >> (shift - 8)) & 0xFF)], 2);
+        break;
+
+    case BASE10: // pairs of digits from the end
+        length = number_digits(u, BASE10);
+        char* end = buf + length;
+        for (; u >= 100; u /= 100)
+            memcpy(end -= 2, &decimal_digits[2 * (u % 100)], 2);
+        if (u >= 10)
+            memcpy(end - 2, &decimal_digits[2 * u], 2);
+        else
+            end[-1] = '0' + u;
+        break;
+
+    default: __builtin_unreachable();
+    }
+    buf[length] = '\0';
+    return length;
+}
+
+#define NUMBER_ONES(BYTE) (UINT64_C(0x0101010101010101) * (BYTE))
+
+// Up to 8 characters right aligned to a uint64_t padded with '0', first
+// character in the lowest byte regardless of endianness.
+static uint64_t number_load8(const char* str, size_t length)
+{
+    char chunk[8] = "00000000";
+    uint64_t x;
+    memcpy(&chunk[8 - length], str, length);
+    memcpy(&x, chunk, sizeof x);
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+    #endif
+    return x;
+}
+
+// High bit of each byte set if lo <= byte <= hi. All bytes must be < 0x80.
+static uint64_t number_bytes_between(uint64_t x, uint8_t lo, uint8_t hi)
+{
+    return (x + NUMBER_ONES(0x80 - lo)) & ~(x + NUMBER_ONES(0x7F - hi)) & NUMBER_ONES(0x80);
+}
+
+// Each parser takes a chunk from number_load8() and returns its value or
+// NUMBER_INVALID if it has other characters than digits.
+
+static uint64_t number_parse8_binary(uint64_t x)
+{
+    if ((x & NUMBER_ONES(0xFE)) != NUMBER_ONES('0'))
+        return NUMBER_INVALID;
+    return ((x & NUMBER_ONES(0x01)) * UINT64_C(0x8040201008040201)) >> 56; // gather bits to top
+}
+
+static uint64_t number_parse8_decimal(uint64_t x)
+{
+    if ((x & NUMBER_ONES(0xF0)) != NUMBER_ONES(0x30)
+        || ((x + NUMBER_ONES(0x06)) & NUMBER_ONES(0xF0)) != NUMBER_ONES(0x30))
+        return NUMBER_INVALID;
+    x -= NUMBER_ONES('0');
+    x = x * 10 + (x >> 8); // pairs of digits in every other byte
+    return ((x & UINT64_C(0x000000FF000000FF)) * (100 + (UINT64_C(1000000) << 32))
+        + ((x >> 16) & UINT64_C(0x000000FF000000FF)) * (1 + (UINT64_C(10000) << 32))) >> 32;
+}
+
+static uint64_t number_parse8_hex(uint64_t x)
+{
+    if (x & NUMBER_ONES(0x80))
+        return NUMBER_INVALID;
+    const uint64_t lower  = x | NUMBER_ONES(0x20);
+    const uint64_t digits = number_bytes_between(x, '0', '9');
+    const uint64_t alphas = number_bytes_between(lower, 'a', 'f');
+    if ((digits | alphas) != NUMBER_ONES(0x80))
+        return NUMBER_INVALID;
+    x = (x & NUMBER_ONES(0x0F)) + (alphas >> 7) * 9;
+    x = ((x <<  4) | (x >>  8)) & UINT64_C(0x00FF00FF00FF00FF);
+    x = ((x <<  8) | (x >> 16)) & UINT64_C(0x0000FFFF0000FFFF);
+    return ((x << 16) | (x >> 32)) & UINT32_MAX;
+}
+
+// Digits without prefix or whitespace. Returns NUMBER_INVALID if there are
+// other characters, no digits or the value does not fit in 32 bits.
+static uint64_t parse_number(const char* digits, size_t length, base_t base)
+{
+    if (length == 0)
+        return NUMBER_INVALID;
+    uint64_t result = 0;
+    size_t   head   = (length - 1) % 8 + 1; // first chunk may be partial
+    switch (base) {
+    case BASE2:
+        if (length > 32)
+            return NUMBER_INVALID;
+        for (; length != 0; digits += head, length -= head, head = 8) {
+            const uint64_t chunk = number_parse8_binary(number_load8(digits, head));
+            if (chunk == NUMBER_INVALID)
+                return NUMBER_INVALID;
+            result = result << 8 | chunk;
+        }
+        return result;
+
+    case BASE10:
+        if (length > 10)
+            return NUMBER_INVALID;
+        for (; length != 0; digits += head, length -= head, head = 8) {
+            const uint64_t chunk = number_parse8_decimal(number_load8(digits, head));
+            if (chunk == NUMBER_INVALID)
+                return NUMBER_INVALID;
+            result = result * 100000000 + chunk;
+        }
+        return result <= UINT32_MAX ? result : NUMBER_INVALID;
+
+    case BASE16:
+        if (length > 8)
+            return NUMBER_INVALID;
+        return number_parse8_hex(number_load8(digits, length));
+
+    default: __builtin_unreachable();
+    }
+}
+
+// --------------------------------
+// Lines
+//
+// Output of the round loop is assembled to a stack buffer from preformatted
+// pieces, so asking questions allocates nothing and parses no format strings.
+
+typedef struct line
+{
+    size_t length;
+    char   buffer[256];
+} Line;
+
+static void line_append(Line* line, const char* str, size_t length)
+{
+    gp_assert(line->length + length <= sizeof line->buffer, line->length, length);
+    memcpy(&line->buffer[line->length], str, length);
+    line->length += length;
+}
+
+#define line_append_literal(LINE, LITERAL) line_append(LINE, LITERAL, sizeof(LITERAL) - sizeof"")
+
+static void line_append_number(Line* line, uint32_t u)
+{
+    char digits[NUMBER_BUFFER_SIZE];
+    line_append(line, digits, format_number(digits, u, BASE10, 32));
+}
+
+// Like printf("%.*f", decimals, x) for non-negative x below 2^32, but halfway
+// cases may round up where printf() would round to the double below.
+static void line_append_fixed(Line* line, double x, unsigned decimals)
+{
+    gp_assert(decimals <= 9, decimals);
+    const uint64_t scale  = decimals == 0 ? 1 : powers_of_ten[decimals];
+    const uint64_t scaled = x * scale + .5;
+    line_append_number(line, scaled / scale);
+    if (decimals == 0)
+        return;
+    char digits[NUMBER_BUFFER_SIZE];
+    size_t length = format_number(digits, scaled % scale, BASE10, 32);
+    line_append_literal(line, ".");
+    line_append(line, "000000000", decimals - length);
+    line_append(line, digits, length);
+}
+
+static void line_append_cursor_forward(Line* line, uint32_t columns)
+{
+    line_append_literal(line, "\033[");
+    line_append_number(line, columns);
+    line_append_literal(line, "C");
+}
+
+static void line_write(const Line* line, FILE* out)
+{
+    fwrite(line->buffer, 1, line->length, out);
+}
+
+// --------------------------------
+// Input
+//
+// Lines are read from a non-blocking fd to our own buffer, so waiting for an
+// answer can give up exactly at a deadline without leaving half read input in
+// stdio buffers.
+
+typedef enum input_status
+{
+    INPUT_LINE,
+    INPUT_KEY,
+    INPUT_TIMEOUT,
+    INPUT_EOF,
+} InputStatus;
+
+typedef struct input
+{
+    int             fd;
+    size_t          length;     // of buffered bytes
+    bool            eof;
+    bool            truncating; // discarding rest of too long line
+    bool            raw;        // terminal in raw mode, see input_raw_mode()
+    clock_ns_t      timestamp;  // of last read bytes
+    char            buffer[256];
+} Input;
+
+#if !_WIN32
+static bool           input_has_original_termios;
+static struct termios input_original_termios;
+
+static void input_restore_terminal(void)
+{
+    if (input_has_original_termios)
+        tcsetattr(STDIN_FILENO, TCSANOW, &input_original_termios);
+}
+
+static void input_restore_terminal_and_reraise(int signal_number)
+{
+    input_restore_terminal();
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+static void input_restore_terminal_at_exit(void)
+{
+    static bool registered = false;
+    if (registered)
+        return;
+    registered = true;
+    atexit(input_restore_terminal);
+    signal(SIGINT,  input_restore_terminal_and_reraise);
+    signal(SIGTERM, input_restore_terminal_and_reraise);
+}
+#endif
+
+// fd stays blocking: its file status flags are shared with stdout and the
+// shell if it is a terminal, and non-blocking mode there would make output fail
+// with EAGAIN. input_fill() waits for input before reading instead.
+static void input_init(Input* in, int fd)
+{
+    *in = (Input){ .fd = fd };
+}
+
+// Raw mode delivers keystrokes as soon as they are typed without echoing them.
+// Signals still work, so Ctrl+C quits as usual. Returns false if fd is not a
+// terminal, in which case input stays line based.
+static bool input_raw_mode(Input* in, bool enable)
+{
+    #if !_WIN32
+    if (in->fd != STDIN_FILENO || ! isatty(in->fd))
+        return false;
+    if ( ! input_has_original_termios) {
+        if (tcgetattr(in->fd, &input_original_termios) == -1)
+            return false;
+        input_has_original_termios = true;
+        input_restore_terminal_at_exit();
+    }
+    struct termios termios = input_original_termios;
+    if (enable) {
+        termios.c_lflag &= ~(ICANON | ECHO);
+        termios.c_cc[VMIN]  = 1;
+        termios.c_cc[VTIME] = 0;
+    }
+    if (tcsetattr(in->fd, TCSANOW, &termios) == -1)
+        return false;
+    return in->raw = enable;
+    #else
+    (void)in; (void)enable;
+    return false;
+    #endif
+}
+
+// Waits for more bytes to buffer and timestamps them. Returns false if timer
+// expired. Readiness is awaited before reading, so the blocking read returns
+// immediately, without blocking past the deadline.
+static bool input_fill(Input* in, const Timer* timer)
+{
+    while (true)
+    {
+        if (timer != NULL && ! timer_wait_input(timer, in->fd))
+            return false;
+        ssize_t bytes_read = read(in->fd, in->buffer + in->length, sizeof in->buffer - in->length);
+        if (bytes_read > 0) {
+            in->length   += bytes_read;
+            in->timestamp = clock_now();
+            return true;
+        } else if (bytes_read == 0) {
+            in->eof = true;
+            return true;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            fprintf(stderr, "hexgame: could not read input: %s\n", strerror(errno));
+            in->eof = true;
+            return true;
+        }
+        #if !_WIN32 // stdin inherited in non-blocking mode
+        else if (errno != EINTR && timer == NULL)
+            poll(&(struct pollfd){ .fd = in->fd, .events = POLLIN }, 1, -1);
+        #endif
+    }
+}
+
+// Blank lines are skipped and too long lines truncated. If timer is NULL, waits
+// indefinitely.
+static InputStatus input_read_line(Input* in, const Timer* timer, char* line, size_t line_size)
+{
+    while (true)
+    {
+        if (timer != NULL && timer_expired(timer))
+            return INPUT_TIMEOUT;
+
+        char* newline = memchr(in->buffer, '\n', in->length);
+        if (newline != NULL || in->length == sizeof in->buffer || (in->eof && in->length > 0))
+        {
+            const size_t length     = newline != NULL ? (size_t)(newline - in->buffer) : in->length;
+            const size_t consumed   = length + (newline != NULL);
+            const bool   truncating = in->truncating;
+            in->truncating = newline == NULL && ! in->eof;
+
+            const size_t copied = gp_min(length, line_size - 1);
+            memcpy(line, in->buffer, copied);
+            line[copied] = '\0';
+            memmove(in->buffer, in->buffer + consumed, in->length - consumed);
+            in->length -= consumed;
+
+            bool blank = true;
+            for (size_t i = 0; i < copied && blank; ++i)
+                blank = isspace((unsigned char)line[i]);
+            if ( ! truncating && ! blank)
+                return INPUT_LINE;
+            continue;
+        }
+        if (in->eof)
+            return INPUT_EOF;
+        if ( ! input_fill(in, timer))
+            return INPUT_TIMEOUT;
+    }
+}
+
+// Single byte of input, keys that send escape sequences come in pieces.
+static InputStatus input_read_key(Input* in, const Timer* timer, char* key)
+{
+    while (true)
+    {
+        if (timer != NULL && timer_expired(timer))
+            return INPUT_TIMEOUT;
+        if (in->length > 0) {
+            *key = in->buffer[0];
+            memmove(in->buffer, in->buffer + 1, --in->length);
+            return INPUT_KEY;
+        }
+        if (in->eof)
+            return INPUT_EOF;
+        if ( ! input_fill(in, timer))
+            return INPUT_TIMEOUT;
+    }
+}
+
+// Returns false if timer expired. We'll interpret Ctrl+D as a quit request.
+static bool read_input(Input* in, const Timer* timer, char* line, size_t line_size)
+{
+    COUNTER_SCOPE(COUNTER_READ_INPUT);
+    InputStatus status = input_read_line(in, timer, line, line_size);
+    if (status == INPUT_EOF) {
+        puts("");
+        exit(EXIT_SUCCESS);
+    }
+    return status == INPUT_LINE;
+}
+
+// --------------------------------
+// Question Sampling
+//
+// Questions are drawn by weight with Vose's alias method: one random number
+// picks a column and a threshold within it, so the cost of sampling doesn't
+// depend on the weights. With 16 questions rebuilding the table after an answer
+// is a constant 16 steps.
+
+#define ALIAS_ONE (1u << 28) // 28 random bits are left after picking column
+
+// Weights are kept within these, so one question can't starve others and
+// rejecting repeats of the previous question stays cheap.
+#define QUESTION_MIN_WEIGHT .25f
+#define QUESTION_MAX_WEIGHT 4.f
+
+typedef struct alias_table
+{
+    uint32_t threshold[16]; // of keeping column instead of its alias
+    uint8_t  alias[16];
+} AliasTable;
+
+static void alias_table_build(AliasTable* table, const float weights[16])
+{
+    double  sum = 0.;
+    double  scaled[16]; // mean of 1
+    uint8_t small[16];
+    uint8_t large[16];
+    size_t  small_length = 0;
+    size_t  large_length = 0;
+
+    for (size_t i = 0; i < 16; ++i)
+        sum += weights[i];
+    for (size_t i = 0; i < 16; ++i) {
+        scaled[i] = 16. * weights[i] / sum;
+        if (scaled[i] < 1.)
+            small[small_length++] = i;
+        else
+            large[large_length++] = i;
+    }
+    while (small_length > 0 && large_length > 0) {
+        uint8_t less = small[--small_length];
+        uint8_t more = large[--large_length];
+        table->threshold[less] = scaled[less] * ALIAS_ONE;
+        table->alias[less]     = more;
+        scaled[more] -= 1. - scaled[less];
+        if (scaled[more] < 1.)
+            small[small_length++] = more;
+        else
+            large[large_length++] = more;
+    }
+    // Leftovers of either are 1 give or take rounding errors.
+    while (large_length > 0) {
+        uint8_t i = large[--large_length];
+        table->threshold[i] = ALIAS_ONE;
+        table->alias[i]     = i;
+    }
+    while (small_length > 0) {
+        uint8_t i = small[--small_length];
+        table->threshold[i] = ALIAS_ONE;
+        table->alias[i]     = i;
+    }
+}
+
+static uint32_t alias_table_sample(const AliasTable* table, uint32_t random)
+{
+    uint32_t column = random & 0xF;
+    return (random >> 4) < table->threshold[column] ? column : table->alias[column];
+}
+
+// Adaptive weights of 4 bit questions and their alias table. Uniform rounds
+// don't need these, so they are kept out of GameRound.
+typedef struct question_table
+{
+    float      weights[16];
+    AliasTable alias;
+} QuestionTable;
+
+// --------------------------------
+// Game Engine
+//
+// Questions and scoring without any I/O or clocks, so the same rounds are
+// played in terminal, server, replay and verify. Frontends own timers and pass
+// reaction times in. Everything touched per question fits in one cache line,
+// questions of adaptive rounds are drawn from a QuestionTable owned by the
+// frontend.
+
+typedef struct game_round
+{
+    _Alignas(64)
+    GPRandomState  rs;
+    QuestionTable* questions;     // NULL for uniform questions
+    double         reaction_time; // sum over correct answers
+    uint32_t       left;          // current question
+    uint32_t       last_left;
+    uint32_t       score;
+    uint32_t       correct;
+    uint8_t        left_base;
+    uint8_t        right_base;
+    uint8_t        bits;          // of questions
+} GameRound;
+
+static_assert(sizeof(GameRound) == 64, "Keep state of a round in one cache line.");
+
+// Rounds in playing order without the overlapping ones.
+static size_t round_index(base_t left_base, base_t right_base)
+{
+    return left_base * (BASE_LENGTH - 1) + right_base - (right_base > left_base);
+}
+
+// Sessions have a seed, from which each round gets its own PCG stream by
+// selecting the increment like pcg32_srandom_r(seed, round_index()) would.
+// gp_random_state() always uses the same stream, so its rounds were only as
+// different as their seeds, and those were seconds from time().
+static GPRandomState session_round_random_state(uint32_t seed, base_t left_base, base_t right_base)
+{
+    const uint64_t multiplier = 6364136223846793005u;
+    GPRandomState rs = { .inc = (uint64_t)round_index(left_base, right_base) << 1 | 1 };
+    rs.state = rs.inc + seed;
+    rs.state = rs.state * multiplier + rs.inc;
+    return rs;
+}
+
+// Random nonzero seed for sessions not given one, different for sessions
+// started in the same second.
+static uint32_t session_seed_new(void)
+{
+    uint64_t x = clock_now() ^ (uint64_t)time(NULL) << 32 ^ (uint64_t)getpid() << 20;
+    x = (x ^ x >> 30) * 0xbf58476d1ce4e5b9u; // splitmix64 finalizer
+    x = (x ^ x >> 27) * 0x94d049bb133111ebu;
+    x = (x ^ x >> 31);
+    return (uint32_t)x != 0 ? (uint32_t)x : 1;
+}
+
+// Questions are drawn by weights stored to questions, which then adapt to
+// answers: wrong answers make a question more frequent and correct ones less.
+// If weights is NULL, questions are uniform and don't adapt, so they only depend
+// on rs and questions is not used. Wider than 4 bit questions are always
+// uniform. Questions must outlive the round.
+static GameRound game_round_new(
+    base_t         left_base,
+    base_t         right_base,
+    unsigned       bits,
+    GPRandomState  rs,
+    QuestionTable* questions,   /*nullable*/
+    const float    weights[16]) /*nullable*/
+{
+    gp_assert(bits == 4 || bits == 8 || bits == 16 || bits == 32, bits);
+    GameRound round = {
+        .rs         = rs,
+        .left_base  = left_base,
+        .right_base = right_base,
+        .bits       = bits,
+        .left       = -1,
+        .last_left  = -1,
+    };
+    if (weights != NULL && bits == 4) {
+        gp_assert(questions != NULL);
+        memcpy(questions->weights, weights, sizeof questions->weights);
+        alias_table_build(&questions->alias, questions->weights);
+        round.questions = questions;
+    }
+    return round;
+}
+
+// Uniform 4 bit questions are the same as from an alias table of equal weights.
+static uint32_t game_round_next_question(GameRound* round)
+{
+    do {
+        if (round->questions != NULL)
+            round->left = alias_table_sample(&round->questions->alias, gp_random(&round->rs));
+        else
+            round->left = gp_random(&round->rs) & number_mask(round->bits);
+    } while (round->left == round->last_left);
+    return round->last_left = round->left;
+}
+
+static void game_round_adapt(GameRound* round, float factor)
+{
+    float* weight = &round->questions->weights[round->left];
+    *weight = gp_min(gp_max(*weight * factor, QUESTION_MIN_WEIGHT), QUESTION_MAX_WEIGHT);
+    alias_table_build(&round->questions->alias, round->questions->weights);
+}
+
+// Returns points earned, 0 for wrong answer. Reaction time is seconds from
+// showing the question, retries after wrong answers included.
+static size_t game_round_submit(GameRound* round, uint64_t right, double reaction_time)
+{
+    if (round->questions != NULL)
+        game_round_adapt(round, right == round->left ? .8f : 2.f);
+    if (right != round->left)
+        return 0;
+    round->correct       += 1;
+    round->reaction_time += gp_max(reaction_time, 0.);
+
+    size_t left_digits  = number_digits(round->left, round->left_base);
+    size_t right_digits = number_digits(right, round->right_base);
+
+    size_t points = left_digits == 1 && right_digits == left_digits ? 1 : 2;
+    round->score += points;
+    return points;
+}
+
+// Mean reaction time of correct answers in milliseconds, 0 if none.
+static uint16_t game_round_reaction_ms(const GameRound* round)
+{
+    if (round->correct == 0)
+        return 0;
+    double ms = 1000. * round->reaction_time / round->correct;
+    return gp_min(gp_max(ms + .5, 1.), (double)UINT16_MAX);
+}
+
+// Strips whitespace and 0x prefix of hexadecimal, which is all the answer
+// syntax there is besides digits.
+static const char* answer_digits(const char* str, size_t* length, base_t base)
+{
+    while (*length > 0 && isspace((unsigned char)*str)) {
+        ++str;
+        --*length;
+    }
+    while (*length > 0 && isspace((unsigned char)str[*length - 1]))
+        --*length;
+    if (base == BASE16 && *length > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        str     += 2;
+        *length -= 2;
+    }
+    return str;
+}
+
+// Answer as typed by user, hexadecimal may have 0x prefix. Unparseable answers
+// never match any question, answer_error() tells why.
+static uint64_t parse_answer(const char* str, size_t length, base_t base)
+{
+    str = answer_digits(str, &length, base);
+    return parse_number(str, length, base);
+}
+
+// Value of digit + 1, 0 for other characters.
+static const uint8_t digit_values[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+// Why parse_answer() did not accept answer, like "digit 2 out of range for
+// base 2". Only for error messages, parsing never needs this. Assembled like
+// lines of the round loop, which shows these. Returns length of message, 0 if
+// answer is a valid number.
+static size_t answer_error(char* message, size_t size, const char* str, size_t length, base_t base)
+{
+    const unsigned radix = base == BASE2 ? 2 : base == BASE10 ? 10 : 16;
+    const char* typed = str;
+    str = answer_digits(str, &length, base);
+    Line error = {0};
+    if (length == 0)
+        line_append_literal(&error, "no digits");
+    for (size_t i = 0; i < length && error.length == 0; ++i) {
+        const uint8_t value = digit_values[(unsigned char)str[i]];
+        const size_t column = str + i - typed + 1;
+        if (value == 0 && isprint((unsigned char)str[i])) {
+            line_append_literal(&error, "unexpected '");
+            line_append(&error, &str[i], 1);
+            line_append_literal(&error, "' at column ");
+            line_append_number(&error, column);
+        } else if (value == 0) {
+            line_append_literal(&error, "unexpected byte 0x");
+            line_append(&error, &hex_digits[2 * (unsigned char)str[i]], 2);
+            line_append_literal(&error, " at column ");
+            line_append_number(&error, column);
+        } else if (value - 1u >= radix) {
+            line_append_literal(&error, "digit ");
+            line_append(&error, &str[i], 1);
+            line_append_literal(&error, " out of range for base ");
+            line_append_number(&error, radix);
+        }
+    }
+    const size_t max_digits = number_digits(UINT32_MAX, base);
+    if (error.length == 0 && length > max_digits) {
+        line_append_number(&error, gp_min(length, (size_t)UINT32_MAX));
+        line_append_literal(&error, " digits, at most ");
+        line_append_number(&error, max_digits);
+        line_append_literal(&error, " fit in 32 bits");
+    } else if (error.length == 0 && parse_number(str, length, base) == NUMBER_INVALID)
+        line_append_literal(&error, "number does not fit in 32 bits");
+
+    const size_t written = gp_min(error.length, size != 0 ? size - 1 : 0);
+    memcpy(message, error.buffer, written);
+    if (size != 0)
+        message[written] = '\0';
+    return written;
+}
+
+// An answer is complete when no more digits could make it any other answer in
+// range, so it can be submitted without waiting for Enter. Questions are shown
+// padded to their width, so answers that fill it are complete, shorter ones
+// are measured without 0x prefix and leading zeros. Zeros alone wait for more,
+// except 0 of 4 bit decimal rounds, which is never padded. Typos are never
+// complete, they can be erased or submitted with Enter.
+static bool answer_is_complete(const char* answer, size_t length, base_t base, unsigned bits)
+{
+    const uint64_t radix = base == BASE2 ? 2 : base == BASE10 ? 10 : 16;
+    if (base == BASE16 && length == 1 && answer[0] == '0')
+        return false; // 0x prefix may follow
+    if (base == BASE16 && length >= 2 && answer[0] == '0' && (answer[1] == 'x' || answer[1] == 'X')) {
+        answer += 2;
+        length -= 2;
+    }
+    const uint64_t value = parse_number(answer, length, base);
+    if (value == NUMBER_INVALID)
+        return false;
+    if (length >= (base == BASE16 ? bits / 4 : number_width(base, bits)))
+        return true;
+    if (value == 0)
+        return base == BASE10 && bits == 4;
+    return value * radix > number_mask(bits);
+}
+
+// --------------------------------
+// Statistics
+//
+// Accuracy and reaction times of every question in every round, so it can be
+// seen which bit patterns are slow to convert. Updating touches one 256 byte
+// block, persisted stats are in stats.bin next to leaderboard.bin.
+
+#define STATS_LATENCY_SUB_BITS 2
+#define STATS_LATENCY_BUCKETS  62 // milliseconds up to 80 s
+
+typedef struct nibble_stats
+{
+    _Alignas(64)
+    uint32_t correct;
+    uint32_t wrong;
+    uint32_t latency[STATS_LATENCY_BUCKETS]; // of correct answers
+} NibbleStats;
+
+static_assert(sizeof(NibbleStats) == 256, "Keep stats of a question in whole cache lines.");
+
+typedef struct stats
+{
+    NibbleStats nibbles[BASE_COMBINATIONS][16]; // by round_index() and question
+} Stats;
+
+// HDR-style log buckets: exact below 2^SUB_BITS ms and 2^SUB_BITS buckets for
+// every doubling after, so the relative error stays under 1/2^SUB_BITS.
+static size_t stats_latency_bucket(double seconds)
+{
+    const uint32_t sub_buckets = 1u << STATS_LATENCY_SUB_BITS;
+    const double   clamped = 1000. * seconds < UINT32_MAX ? 1000. * seconds : UINT32_MAX;
+    const uint32_t ms      = clamped > 0. ? clamped : 0;
+    if (ms < sub_buckets)
+        return ms;
+    const unsigned msb = 31 - __builtin_clz(ms);
+    const size_t bucket = (msb - STATS_LATENCY_SUB_BITS + 1) << STATS_LATENCY_SUB_BITS
+        | ((ms >> (msb - STATS_LATENCY_SUB_BITS)) & (sub_buckets - 1));
+    return gp_min(bucket, (size_t)STATS_LATENCY_BUCKETS - 1);
+}
+
+// Smallest milliseconds falling in bucket.
+static uint32_t stats_bucket_ms(size_t bucket)
+{
+    const uint32_t sub_buckets = 1u << STATS_LATENCY_SUB_BITS;
+    if (bucket < sub_buckets)
+        return bucket;
+    const unsigned msb = (bucket >> STATS_LATENCY_SUB_BITS) + STATS_LATENCY_SUB_BITS - 1;
+    return (sub_buckets | (bucket & (sub_buckets - 1))) << (msb - STATS_LATENCY_SUB_BITS);
+}
+
+static void stats_record(
+    Stats* stats, base_t left_base, base_t right_base, uint32_t question, bool correct, double reaction_time)
+{
+    NibbleStats* nibble = &stats->nibbles[round_index(left_base, right_base)][question & 0xF];
+    if ( ! correct)
+        ++nibble->wrong;
+    else {
+        ++nibble->correct;
+        ++nibble->latency[stats_latency_bucket(reaction_time)];
+    }
+}
+
+static void stats_add(Stats* stats, const Stats* other)
+{
+    uint32_t*       counts       = (uint32_t*)stats;
+    const uint32_t* other_counts = (const uint32_t*)other;
+    for (size_t i = 0; i < sizeof*stats / sizeof counts[0]; ++i)
+        counts[i] += other_counts[i];
+}
+
+// Reaction time in seconds that a fraction of correct answers did not exceed,
+// estimated as the middle of the bucket it falls in.
+static double stats_latency_percentile(const NibbleStats* nibble, double fraction)
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < STATS_LATENCY_BUCKETS; ++i)
+        if ((count += nibble->latency[i]) >= fraction * nibble->correct && count > 0) {
+            uint32_t high = i + 1 < STATS_LATENCY_BUCKETS ? stats_bucket_ms(i + 1) : stats_bucket_ms(i) + 1;
+            return (stats_bucket_ms(i) + high) / 2000.;
+        }
+    return 0.;
+}
+
+// Question weights carried over sessions. A question gets weaker the more it's
+// answered wrong and the slower it's answered compared to other questions of
+// the round. With time weights fade back to neutral 1 with a power law like
+// memories do, so learned questions come back for repetition and weak ones
+// don't dominate forever.
+
+#define SCHEDULE_FADE_TIME     (3*24*60*60.) // seconds to fade halfway
+#define SCHEDULE_LEARNING_RATE .3
+
+typedef struct schedule
+{
+    int64_t updated; // unix time
+    float   weights[BASE_COMBINATIONS][16];
+} Schedule;
+
+static void schedule_init(Schedule* schedule)
+{
+    schedule->updated = 0;
+    for (size_t round = 0; round < BASE_COMBINATIONS; ++round)
+        for (size_t i = 0; i < 16; ++i)
+            schedule->weights[round][i] = 1.f;
+}
+
+static void schedule_decay(Schedule* schedule, time_t now)
+{
+    if (schedule->updated != 0 && now > schedule->updated) {
+        const double keep = 1. / (1. + (now - schedule->updated) / SCHEDULE_FADE_TIME);
+        for (size_t round = 0; round < BASE_COMBINATIONS; ++round)
+            for (size_t i = 0; i < 16; ++i)
+                schedule->weights[round][i] = 1. + (schedule->weights[round][i] - 1.) * keep;
+    }
+    schedule->updated = now;
+}
+
+static void schedule_learn(Schedule* schedule, const Stats* session)
+{
+    for (size_t round = 0; round < BASE_COMBINATIONS; ++round)
+    {
+        const NibbleStats* nibbles = session->nibbles[round];
+        double median_sum   = 0.;
+        size_t median_count = 0;
+        double medians[16]  = {0};
+        for (size_t i = 0; i < 16; ++i)
+            if (nibbles[i].correct > 0) {
+                median_sum += medians[i] = stats_latency_percentile(&nibbles[i], .5);
+                median_count += 1;
+            }
+        const double mean_median = median_count > 0 ? median_sum / median_count : 0.;
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const uint32_t answers = nibbles[i].correct + nibbles[i].wrong;
+            if (answers == 0)
+                continue;
+            const double accuracy = (double)nibbles[i].correct / answers;
+            const double slowness = nibbles[i].correct == 0 || mean_median == 0. ?
+                QUESTION_MAX_WEIGHT : medians[i] / mean_median;
+            const double observed = gp_min(gp_max((2. - accuracy) * slowness,
+                (double)QUESTION_MIN_WEIGHT), (double)QUESTION_MAX_WEIGHT);
+
+            float* weight = &schedule->weights[round][i];
+            *weight += SCHEDULE_LEARNING_RATE * (observed - *weight);
+        }
+    }
+}
+
+// --------------------------------
+// Live Scoreboard
+//
+// Running games publish their current round score to live.bin, which every
+// game maps to memory. Each game owns one slot guarded by a seqlock: the owner
+// makes the sequence odd, writes, and makes it even again, readers retry if the
+// sequence was odd or changed while copying. Publishing and reading are plain
+// memory accesses, and readers never make writers wait. The file never leaves
+// the machine, so unlike leaderboard.bin it is in native byte order.
+
+#define LIVE_MAGIC    "HEXLIVE"
+#define LIVE_VERSION  1
+#define LIVE_CAPACITY 64
+
+// Players that have not published for this long are not shown.
+#define LIVE_TIMEOUT (ROUND_DURATION + 5.)
+
+typedef struct live_player
+{
+    char     name[16]; // not null-terminated if full
+    uint64_t updated;  // clock_now() of last publish, 0 for never
+    uint32_t score;
+    uint8_t  left_base;
+    uint8_t  right_base;
+    uint8_t  bits;
+    uint8_t  reserved;
+} LivePlayer;
+
+typedef struct live_slot
+{
+    uint32_t sequence; // odd while being written
+    uint32_t pid;      // 0 for free
+    uint64_t player[sizeof(LivePlayer) / sizeof(uint64_t)]; // copied word by word
+    uint8_t  reserved[24];
+} LiveSlot;
+
+typedef struct live_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint8_t  reserved[48];
+} LiveHeader;
+
+static_assert(sizeof(LiveSlot)   == 64, "Keep live slots in their own cache lines.");
+static_assert(sizeof(LiveHeader) == 64, "Keep live slots in their own cache lines.");
+
+typedef struct live
+{
+    LiveHeader* header; // NULL if not available
+    LiveSlot*   slots;
+    LiveSlot*   own;    // NULL if all slots were taken
+    LivePlayer  player;
+} Live;
+
+#define LIVE_FILE_SIZE (sizeof(LiveHeader) + LIVE_CAPACITY * sizeof(LiveSlot))
+
+// Only the owner of slot writes to it.
+static void live_write(LiveSlot* slot, const LivePlayer* player)
+{
+    uint64_t words[sizeof slot->player / sizeof slot->player[0]];
+    memcpy(words, player, sizeof words);
+    const uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < sizeof words / sizeof words[0]; ++i)
+        __atomic_store_n(&slot->player[i], words[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Owners that died without releasing their slots are detected when claiming.
+static bool live_slot_is_abandoned(const LiveSlot* slot, uint32_t pid, clock_ns_t now)
+{
+    #if _WIN32
+    (void)slot; (void)pid; (void)now;
+    return false;
+    #else
+    LivePlayer player;
+    memcpy(&player, slot->player, sizeof player); // racy, but only for a hint
+    return (player.updated == 0 || clock_diff(now, player.updated) > LIVE_TIMEOUT)
+        && kill(pid, 0) == -1 && errno == ESRCH;
+    #endif
+}
+
+// Maps live.bin in directory dir and claims a slot. If dir is NULL or there is
+// no free slot, the game is played without live scores.
+static void live_open(Live* live, const char* dir, const char* name)
+{
+    *live = (Live){0};
+    memcpy(live->player.name, name, strnlen(name, sizeof live->player.name));
+    #if _WIN32
+    (void)dir;
+    #else
+    if (dir == NULL)
+        return;
+    char path[4096];
+    snprintf(path, sizeof path, "%s/live.bin", dir);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 ||
+        (st.st_size < (off_t)LIVE_FILE_SIZE && ftruncate(fd, LIVE_FILE_SIZE) == -1)) {
+        fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+    void* image = mmap(NULL, LIVE_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    gp_assert(close(fd) != -1, strerror(errno));
+    if (image == MAP_FAILED) {
+        fprintf(stderr, "hexgame: cannot map %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    // Concurrent games write the same header to a new file.
+    LiveHeader expected = { .version = LIVE_VERSION, .capacity = LIVE_CAPACITY };
+    memcpy(expected.magic, LIVE_MAGIC, sizeof expected.magic);
+    LiveHeader* header = image;
+    if (header->magic[0] == '\0')
+        memcpy(header, &expected, sizeof expected);
+    if (memcmp(header, &expected, sizeof expected) != 0) {
+        fprintf(stderr, "hexgame: %s is not a valid live scoreboard file.\n", path);
+        gp_assert(munmap(image, LIVE_FILE_SIZE) != -1, strerror(errno));
+        return;
+    }
+    live->header = header;
+    live->slots  = (LiveSlot*)(header + 1);
+
+    const uint32_t   pid = getpid();
+    const clock_ns_t now = clock_now();
+    for (size_t i = 0; i < LIVE_CAPACITY && live->own == NULL; ++i) {
+        LiveSlot* slot  = &live->slots[i];
+        uint32_t  owner = __atomic_load_n(&slot->pid, __ATOMIC_RELAXED);
+        if ((owner == 0 || live_slot_is_abandoned(slot, owner, now)) &&
+            __atomic_compare_exchange_n(&slot->pid, &owner, pid, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            live->own = slot;
+    }
+    if (live->own != NULL) // hide scores of previous owner
+        live_write(live->own, &live->player);
+    #endif
+}
+
+static void live_close(Live* live)
+{
+    #if !_WIN32
+    if (live->own != NULL)
+        __atomic_store_n(&live->own->pid, 0, __ATOMIC_RELEASE);
+    if (live->header != NULL)
+        gp_assert(munmap(live->header, LIVE_FILE_SIZE) != -1, strerror(errno));
+    #endif
+    *live = (Live){0};
+}
+
+static void live_publish(Live* live, base_t left_base, base_t right_base, unsigned bits, uint32_t score)
+{
+    live->player.updated    = clock_now();
+    live->player.score      = score;
+    live->player.left_base  = left_base;
+    live->player.right_base = right_base;
+    live->player.bits       = bits;
+    if (live->own != NULL)
+        live_write(live->own, &live->player);
+}
+
+// Returns false if slot is free or its owner kept writing while we read.
+static bool live_read(const LiveSlot* slot, LivePlayer* player)
+{
+    uint64_t words[sizeof slot->player / sizeof slot->player[0]];
+    for (size_t attempt = 0; attempt < 8; ++attempt) {
+        const uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence % 2 != 0)
+            continue;
+        for (size_t i = 0; i < sizeof words / sizeof words[0]; ++i)
+            words[i] = __atomic_load_n(&slot->player[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence)
+            continue;
+        memcpy(player, words, sizeof*player);
+        return __atomic_load_n(&slot->pid, __ATOMIC_RELAXED) != 0;
+    }
+    return false;
+}
+
+// Others playing the same round as our last publish, best first.
+static size_t live_ranking(const Live* live, LivePlayer others[LIVE_CAPACITY])
+{
+    size_t length = 0;
+    const clock_ns_t now = clock_now();
+    for (size_t i = 0; live->header != NULL && i < LIVE_CAPACITY; ++i) {
+        LivePlayer player;
+        if (&live->slots[i] == live->own || ! live_read(&live->slots[i], &player))
+            continue;
+        if (player.left_base  != live->player.left_base  ||
+            player.right_base != live->player.right_base ||
+            player.bits       != live->player.bits       ||
+            player.updated == 0 || clock_diff(now, player.updated) > LIVE_TIMEOUT)
+            continue;
+
+        size_t position = length++;
+        for (; position > 0 && others[position - 1].score < player.score; --position)
+            others[position] = others[position - 1];
+        others[position] = player;
+    }
+    return length;
+}
+
+// " | #2 of 5" if others are playing the same round.
+static void line_append_live_rank(Line* line, const Live* live)
+{
+    LivePlayer others[LIVE_CAPACITY];
+    const size_t length = live_ranking(live, others);
+    if (length == 0)
+        return;
+    size_t ahead = 0;
+    while (ahead < length && others[ahead].score > live->player.score)
+        ++ahead;
+    line_append_literal(line, " | #");
+    line_append_number(line, ahead + 1);
+    line_append_literal(line, " of ");
+    line_append_number(line, length + 1);
+}
+
+// Top of the round like "Live: 1. alice 24 | 2. you 12", nothing if playing
+// alone.
+static void line_append_live_ranking(Line* line, const Live* live)
+{
+    LivePlayer others[LIVE_CAPACITY];
+    const size_t length = live_ranking(live, others);
+    if (length == 0)
+        return;
+    line_append_literal(line, "Live:");
+    bool shown_self = false;
+    for (size_t rank = 1, i = 0; rank <= 5 && i + shown_self <= length; ++rank) {
+        const bool self = ! shown_self && (i == length || others[i].score <= live->player.score);
+        const LivePlayer* player = self ? &live->player : &others[i++];
+        shown_self |= self;
+        if (rank == 1)
+            line_append_literal(line, " ");
+        else
+            line_append_literal(line, " | ");
+        line_append_number(line, rank);
+        line_append_literal(line, ". ");
+        if (self)
+            line_append_literal(line, "you");
+        else
+            line_append(line, player->name, strnlen(player->name, sizeof player->name));
+        line_append_literal(line, " ");
+        line_append_number(line, player->score);
+    }
+    line_append_literal(line, "\n");
+}
+
+// --------------------------------
+// Event Log
+//
+// Terminal games append every question, keystroke, answer and result to
+// events.bin for `hexgame analyze`. Events are buffered to blocks, each of
+// which is appended with one write(), so concurrent games don't interleave
+// within blocks. Blocks can be decoded alone:
+//
+//     "HXEV" varint(length of rest)
+//     varint(seed) varint(timestamp) varint(name length) name
+//     byte(left_base) byte(right_base) byte(bits)
+//     events...
+//
+// Events start with varint(microseconds since previous event << 3 | type),
+// counting from round start. A block holds a whole round and is written at its
+// end, so typing never waits for disk. Keystrokes that don't fit are dropped,
+// other events get written when the block is full. Blocks are synced to disk
+// once per session, when it ends. Blocks of rounds have left_base !=
+// right_base, the last block of a session has only EVENT_SESSION. Rounds cut
+// short by quitting are not logged.
+
+typedef enum event_type
+{
+    EVENT_QUESTION, // varint(question)
+    EVENT_KEY,      // byte(key), only in raw mode
+    EVENT_CORRECT,  // varint(points)
+    EVENT_WRONG,    // varint(answer + 1), 0 if unparseable
+    EVENT_ROUND,    // varint(score), ends round
+    EVENT_SESSION,  // varint(total score) varint(name length) name
+} EventType;
+
+#define EVENT_LOG_MAGIC      "HXEV"
+#define EVENT_LOG_BLOCK_SIZE 65536 // over 20000 keystrokes, far more than a round
+#define VARINT_MAX           10    // bytes of 64 bits
+
+typedef struct event_log
+{
+    int        fd;        // -1 if not logging
+    uint32_t   seed;
+    int64_t    timestamp; // of session start
+    char       name[16];
+    uint8_t    left_base;
+    uint8_t    right_base;
+    uint8_t    bits;
+    bool       has_question;
+    uint32_t   question;  // repeated in the next block if it gets full
+    clock_ns_t asked_at;
+    clock_ns_t round_start;
+    uint64_t   last_us;   // of previous event in block
+    size_t     length;
+    uint8_t    buffer[EVENT_LOG_BLOCK_SIZE];
+} EventLog;
+
+static size_t varint_encode(uint8_t buf[VARINT_MAX], uint64_t x)
+{
+    size_t length = 0;
+    for (; x >= 0x80; x >>= 7)
+        buf[length++] = x | 0x80;
+    buf[length++] = x;
+    return length;
+}
+
+// Advances *p past the varint. Returns false if it does not end before end.
+static bool varint_decode(const uint8_t** p, const uint8_t* end, uint64_t* x)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; *p < end && shift < 64; shift += 7) {
+        const uint8_t byte = *(*p)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            *x = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Opens events.bin in directory dir. If dir is NULL or the file cannot be
+// opened, nothing is logged.
+static void event_log_open(EventLog* log, const char* dir, const char* name, uint32_t seed, unsigned bits)
+{
+    *log = (EventLog){ .fd = -1, .seed = seed, .timestamp = time(NULL), .bits = bits };
+    memcpy(log->name, name, strnlen(name, sizeof log->name));
+    if (dir == NULL)
+        return;
+    char path[4096 + sizeof"/events.bin"];
+    snprintf(path, sizeof path, "%s/events.bin", dir);
+    if ((log->fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644)) == -1)
+        fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+}
+
+static void event_log_flush(EventLog* log)
+{
+    if (log->length == 0)
+        return;
+    uint8_t header[3 * VARINT_MAX + sizeof log->name + 3];
+    size_t header_length = 0;
+    header_length += varint_encode(&header[header_length], log->seed);
+    header_length += varint_encode(&header[header_length], log->timestamp);
+    const size_t name_length = strnlen(log->name, sizeof log->name);
+    header_length += varint_encode(&header[header_length], name_length);
+    memcpy(&header[header_length], log->name, name_length);
+    header_length += name_length;
+    header[header_length++] = log->left_base;
+    header[header_length++] = log->right_base;
+    header[header_length++] = log->bits;
+
+    uint8_t prefix[sizeof EVENT_LOG_MAGIC - 1 + VARINT_MAX + sizeof header];
+    size_t prefix_length = sizeof EVENT_LOG_MAGIC - 1;
+    memcpy(prefix, EVENT_LOG_MAGIC, prefix_length);
+    prefix_length += varint_encode(&prefix[prefix_length], header_length + log->length);
+    memcpy(&prefix[prefix_length], header, header_length);
+    prefix_length += header_length;
+
+    // Events are written from the buffer as they are, one write() per block.
+    #if !_WIN32
+    const struct iovec parts[] = { { prefix, prefix_length }, { log->buffer, log->length } };
+    const bool written = writev(log->fd, parts, 2) == (ssize_t)(prefix_length + log->length);
+    #else // no writev() nor atomic appends on Windows anyway
+    const bool written = write(log->fd, prefix, prefix_length) == (ssize_t)prefix_length
+        && write(log->fd, log->buffer, log->length) == (ssize_t)log->length;
+    #endif
+    if ( ! written)
+        fprintf(stderr, "hexgame: could not write events: %s\n", strerror(errno));
+    log->length  = 0;
+    log->last_us = 0;
+}
+
+// Appends tag of an event, after which at most size bytes follow. Events before
+// round start or previous event are logged at the same time as it.
+static void event_log_begin(EventLog* log, clock_ns_t at, EventType type, size_t size)
+{
+    if (log->length + VARINT_MAX + size > sizeof log->buffer) {
+        event_log_flush(log);
+        if (log->has_question && type != EVENT_QUESTION) { // for reaction times in the next block
+            event_log_begin(log, log->asked_at, EVENT_QUESTION, VARINT_MAX);
+            log->length += varint_encode(&log->buffer[log->length], log->question);
+        }
+    }
+    uint64_t us = at > log->round_start ? (at - log->round_start) / 1000 : 0;
+    us = gp_max(us, log->last_us);
+    log->length += varint_encode(&log->buffer[log->length], (us - log->last_us) << 3 | type);
+    log->last_us = us;
+}
+
+static void event_log_round(EventLog* log, base_t left_base, base_t right_base, clock_ns_t start)
+{
+    log->left_base    = left_base;
+    log->right_base   = right_base;
+    log->round_start  = start;
+    log->has_question = false;
+    log->last_us      = 0;
+}
+
+static void event_log_question(EventLog* log, clock_ns_t at, uint32_t question)
+{
+    if (log->fd == -1)
+        return;
+    event_log_begin(log, at, EVENT_QUESTION, VARINT_MAX);
+    log->length      += varint_encode(&log->buffer[log->length], question);
+    log->has_question = true;
+    log->question     = question;
+    log->asked_at     = at;
+}
+
+static void event_log_key(EventLog* log, clock_ns_t at, char key)
+{
+    if (log->fd == -1 || log->length + VARINT_MAX + 1 > sizeof log->buffer)
+        return;
+    event_log_begin(log, at, EVENT_KEY, 1);
+    log->buffer[log->length++] = key;
+}
+
+// Points is 0 for wrong answers.
+static void event_log_answer(EventLog* log, clock_ns_t at, uint64_t answer, size_t points)
+{
+    if (log->fd == -1)
+        return;
+    event_log_begin(log, at, points != 0 ? EVENT_CORRECT : EVENT_WRONG, VARINT_MAX);
+    log->length += varint_encode(&log->buffer[log->length], points != 0 ? points : answer + 1);
+}
+
+static void event_log_round_end(EventLog* log, clock_ns_t at, size_t score)
+{
+    if (log->fd == -1)
+        return;
+    event_log_begin(log, at, EVENT_ROUND, VARINT_MAX);
+    log->length += varint_encode(&log->buffer[log->length], score);
+    event_log_flush(log);
+}
+
+// Logs the result of the session as submitted to leaderboard and syncs.
+static void event_log_close(EventLog* log, size_t total, const char* name)
+{
+    if (log->fd == -1)
+        return;
+    event_log_round(log, 0, 0, clock_now());
+    const size_t name_length = strnlen(name, sizeof log->name);
+    event_log_begin(log, log->round_start, EVENT_SESSION, 2 * VARINT_MAX + name_length);
+    log->length += varint_encode(&log->buffer[log->length], total);
+    log->length += varint_encode(&log->buffer[log->length], name_length);
+    memcpy(&log->buffer[log->length], name, name_length);
+    log->length += name_length;
+    event_log_flush(log);
+    #if !_WIN32
+    fsync(log->fd);
+    #endif
+    gp_assert(close(log->fd) != -1, strerror(errno));
+    log->fd = -1;
+}
+
+// --------------------------------
+// Renderer
+//
+// The terminal frontend draws everything through a renderer, so that each
+// update of the screen is a single write(). Finished lines scroll up above a
+// live line, which holds the question being answered. Frames are built in a
+// buffer allocated once and only the part of the live line that changed since
+// the previous frame is redrawn, so echoing a keystroke over a slow SSH
+// connection costs a few bytes instead of several writes and a redraw.
+
+#define RENDERER_FRAME_CAPACITY 8192 // grows if ever exceeded, never shrinks
+
+typedef struct renderer
+{
+    GPString frame; // emptied after every write
+    int      fd;
+    bool     below; // terminal echoed a line, cursor is below the shown live line
+    Line     shown; // live line as on screen
+    Line     live;  // live line of next frame
+} Renderer;
+
+static void renderer_init(Renderer* renderer, int fd)
+{
+    memset(renderer, 0, sizeof*renderer);
+    renderer->fd    = fd;
+    renderer->frame = gp_str_new(gp_heap, RENDERER_FRAME_CAPACITY);
+}
+
+static void renderer_delete(Renderer* renderer)
+{
+    gp_str_delete(renderer->frame);
+}
+
+static void renderer_append_line(Renderer* renderer, const Line* line)
+{
+    gp_str_append(&renderer->frame, line->buffer, line->length);
+}
+
+// Prints text above the live line, which is cleared and redrawn below it.
+static void renderer_print(Renderer* renderer, const char* text, size_t length)
+{
+    if (renderer->below)
+        gp_str_append(&renderer->frame, GP_CURSOR_UP(1), sizeof GP_CURSOR_UP(1) - sizeof"");
+    if (renderer->below || renderer->shown.length > 0)
+        gp_str_append(&renderer->frame, "\r\033[K", sizeof"\r\033[K" - sizeof"");
+    renderer->below        = false;
+    renderer->shown.length = 0;
+    gp_str_append(&renderer->frame, text, length);
+}
+
+#define renderer_print_literal(RENDERER, LITERAL) \
+    renderer_print(RENDERER, LITERAL, sizeof(LITERAL) - sizeof"")
+
+// Terminal echoed line of input after the shown live line.
+static void renderer_echoed(Renderer* renderer, const char* input, size_t length)
+{
+    line_append(&renderer->shown, input, length);
+    line_append(&renderer->live,  input, length);
+    renderer->below = true;
+}
+
+// Draws the changed part of the live line to frame.
+static void renderer_draw(Renderer* renderer)
+{
+    const Line* shown = &renderer->shown;
+    const Line* live  = &renderer->live;
+    Line cursor = {0};
+    if (renderer->below) { // back to end of shown
+        line_append_literal(&cursor, GP_CURSOR_UP(1) "\r");
+        if (shown->length > 0)
+            line_append_cursor_forward(&cursor, shown->length);
+        renderer->below = false;
+    }
+    size_t common = 0;
+    while (common < shown->length && common < live->length
+        && shown->buffer[common] == live->buffer[common])
+        ++common;
+    if (common < shown->length) {
+        line_append_literal(&cursor, "\033[");
+        line_append_number(&cursor, shown->length - common);
+        line_append_literal(&cursor, "D");
+    }
+    renderer_append_line(renderer, &cursor);
+    gp_str_append(&renderer->frame, &live->buffer[common], live->length - common);
+    if (live->length < shown->length)
+        gp_str_append(&renderer->frame, "\033[K", sizeof"\033[K" - sizeof"");
+    memcpy(&renderer->shown, live, sizeof renderer->shown);
+}
+
+// Leaves the live line followed by suffix to scroll up with printed text.
+static void renderer_keep(Renderer* renderer, const char* suffix, size_t suffix_length)
+{
+    const bool echoed = renderer->below && suffix_length == 0
+        && renderer->shown.length == renderer->live.length
+        && memcmp(renderer->shown.buffer, renderer->live.buffer, renderer->live.length) == 0;
+    if ( ! echoed) {
+        renderer_draw(renderer);
+        gp_str_append(&renderer->frame, suffix, suffix_length);
+        if (renderer->shown.length + suffix_length > 0)
+            gp_str_append(&renderer->frame, "\n", 1);
+    }
+    renderer->below        = false;
+    renderer->shown.length = 0;
+}
+
+// Draws the live line and writes the whole frame.
+static void renderer_present(Renderer* renderer)
+{
+    renderer_draw(renderer);
+    const char* frame  = (const char*)renderer->frame;
+    size_t      length = gp_str_length(renderer->frame);
+    while (length > 0) {
+        ssize_t written = write(renderer->fd, frame, length);
+        if (written >= 0) {
+            frame  += written;
+            length -= written;
+        }
+        #if !_WIN32 // stdout inherited in non-blocking mode
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            poll(&(struct pollfd){ .fd = renderer->fd, .events = POLLOUT }, 1, -1);
+        #endif
+        else if (errno != EINTR)
+            break;
+    }
+    gp_str_set(renderer->frame)->length = 0;
+}
+
+// Reads answer to answer_size - 1 bytes and time of its last keystroke to
+// answered_at. In raw mode, answers are edited and echoed on the live line of
+// renderer and submitted as soon as they are complete, otherwise they are read
+// as lines echoed by terminal. Keystrokes are logged to events. Returns false
+// if timer expired, Ctrl+D quits.
+static bool read_answer(
+    Input*           input,
+    const Timer*     timer,
+    Renderer*        renderer,
+    EventLog*        events,
+    base_t           base,
+    unsigned         bits,
+    char*            answer,
+    size_t           answer_size,
+    clock_ns_t*      answered_at)
+{
+    if ( ! input->raw) {
+        if ( ! read_input(input, timer, answer, answer_size))
+            return false;
+        *answered_at = input->timestamp;
+        #if !_WIN32
+        if ( ! isatty(input->fd)) { // nothing echoed, drawn as in raw mode
+            line_append(&renderer->live, answer, strlen(answer));
+            return true;
+        }
+        #endif
+        renderer_echoed(renderer, answer, strlen(answer));
+        return true;
+    }
+
+    const size_t prompt_length = renderer->live.length;
+    size_t length = 0;
+    while (true)
+    {
+        char key;
+        InputStatus status = input_read_key(input, timer, &key);
+        if (status == INPUT_TIMEOUT)
+            return false;
+        if (status == INPUT_KEY)
+            event_log_key(events, input->timestamp, key);
+        if (status == INPUT_EOF || (key == 0x04 && length == 0)) { // Ctrl+D
+            renderer_keep(renderer, "", 0);
+            renderer_present(renderer);
+            exit(EXIT_SUCCESS);
+        }
+
+        if (key == '\033') { // skip escape sequences of arrow keys and such
+            if (input_read_key(input, timer, &key) == INPUT_KEY && (key == '[' || key == 'O'))
+                while (input_read_key(input, timer, &key) == INPUT_KEY && ! ('@' <= key && key <= '~'))
+                    ;
+            continue;
+        } else if (key == '\n' || key == '\r') {
+            if (length == 0)
+                continue;
+        } else if (key == 0x7F || key == '\b') { // backspace
+            if (length == 0)
+                continue;
+            --length;
+        } else if (key == 0x15) { // Ctrl+U
+            length = 0;
+        } else if (isgraph((unsigned char)key) && length < answer_size - 1) {
+            answer[length++] = key;
+        } else
+            continue;
+
+        renderer->live.length = prompt_length;
+        line_append(&renderer->live, answer, length);
+        if (key == '\n' || key == '\r' || (isgraph((unsigned char)key) && answer_is_complete(answer, length, base, bits)))
+            break; // drawn in the same frame as result
+        renderer_present(renderer);
+    }
+    answer[length] = '\0';
+    *answered_at   = input->timestamp;
+    return true;
+}
+
+// Terminal frontend. If record is not NULL, answers are recorded in a format
+// that can be replayed by replay_round(). Everything is logged to events. 4 bit
+// questions are drawn by weights of schedule and answers to them are counted
+// to stats, mean reaction time of questions of any width is stored to
+// reaction_ms.
+static size_t game(
+    size_t          round,
+    base_t          left_base,
+    base_t          right_base,
+    unsigned        bits,
+    Renderer*       renderer,
+    Input*          input,
+    FILE*           record,
+    EventLog*       events,
+    uint32_t        seed,     // of session
+    const Schedule* schedule, // NULL for uniform questions that only depend on seed
+    Stats*          stats,
+    Live*           live,
+    uint16_t*       reaction_ms)
+{
+    const float* weights = schedule != NULL && bits == 4 ? schedule->weights[round_index(left_base, right_base)] : NULL;
+    QuestionTable questions;
+    GameRound state = game_round_new(
+        left_base, right_base, bits, session_round_random_state(seed, left_base, right_base), &questions, weights);
+
+    Line line = {0};
+    line_append_literal(&line, "Round ");
+    line_append_number(&line, round);
+    line_append_literal(&line, " : Convert ");
+    line_append(&line, base_lowercase[left_base], strlen(base_lowercase[left_base]));
+    line_append_literal(&line, " to ");
+    line_append(&line, base_lowercase[right_base], strlen(base_lowercase[right_base]));
+    line_append_literal(&line, "\nGet ready...\n");
+    renderer_print(renderer, line.buffer, line.length);
+
+    COUNTER_BEGIN(COUNTER_GAME_COUNTDOWN);
+    Timer countdown_timer = timer_new(0.);
+    for (size_t countdown = ROUND_COUNTDOWN; countdown != 0; --countdown) {
+        renderer->live.length = 0;
+        line_append_number(&renderer->live, countdown);
+        renderer_present(renderer);
+        timer_extend(&countdown_timer, 1.);
+        timer_sleep(&countdown_timer);
+    }
+    COUNTER_END(COUNTER_GAME_COUNTDOWN);
+
+    if (record != NULL && bits != 4)
+        fprintf(record, "session %lu bits %u\n", (unsigned long)seed, bits);
+    else if (record != NULL)
+        fprintf(record, "session %lu\n", (unsigned long)seed);
+    if (record != NULL && weights != NULL) {
+        fprintf(record, "weights");
+        for (size_t i = 0; i < 16; ++i)
+            fprintf(record, " %.9g", weights[i]); // exact for floats
+        fprintf(record, "\n");
+    }
+    // Questions are right aligned to at least 4 columns followed by ": ".
+    const size_t question_width = gp_max(number_width(left_base, bits), (size_t)4);
+    const char*  answer_prefix  = right_base == BASE2 ? "0b" : right_base == BASE16 ? "0x" : "";
+
+    double last_answer_time = 0.;
+    Timer round_timer = timer_new(ROUND_DURATION);
+    event_log_round(events, left_base, right_base, round_timer.start);
+    live_publish(live, left_base, right_base, bits, 0);
+    while ( ! timer_expired(&round_timer))
+    {
+        COUNTER_BEGIN(COUNTER_GAME_QUESTION);
+        uint32_t left = game_round_next_question(&state);
+        clock_ns_t asked_at = 0;
+
+        Line prompt = {0};
+        char question[NUMBER_BUFFER_SIZE];
+        const size_t question_length = format_number(question, left, left_base, bits);
+        line_append(&prompt, "                                ", question_width - question_length);
+        line_append(&prompt, question, question_length);
+        line_append_literal(&prompt, ": ");
+        line_append(&prompt, answer_prefix, strlen(answer_prefix));
+        COUNTER_END(COUNTER_GAME_QUESTION);
+
+        try_again:;
+        COUNTER_BEGIN(COUNTER_GAME_ANSWER);
+        memcpy(&renderer->live, &prompt, sizeof prompt);
+        renderer_present(renderer);
+        if (asked_at == 0) {
+            asked_at = clock_now();
+            event_log_question(events, asked_at, left);
+        }
+
+        char answer[128] = "";
+        clock_ns_t answered_at;
+        if ( ! read_answer(input, &round_timer, renderer, events, right_base, bits, answer, sizeof answer, &answered_at)) {
+            COUNTER_END(COUNTER_GAME_ANSWER);
+            renderer_keep(renderer, "", 0);
+            renderer_print_literal(renderer, GP_YELLOW "Time's up!" GP_RESET_TERMINAL "\n");
+            break;
+        }
+        COUNTER_END(COUNTER_GAME_ANSWER);
+
+        COUNTER_BEGIN(COUNTER_GAME_SUBMIT);
+        if (record != NULL) {
+            // Lines typed ahead during countdown were read before the round.
+            double now = gp_max(clock_diff(answered_at, round_timer.start), last_answer_time);
+            line.length = 0;
+            line_append_fixed(&line, now - last_answer_time, 9);
+            line_append_literal(&line, " ");
+            line_append(&line, answer, strlen(answer));
+            line_append_literal(&line, "\n");
+            line_write(&line, record);
+            last_answer_time = now;
+        }
+
+        const double reaction_time = clock_diff(answered_at, asked_at);
+        const uint64_t right = parse_answer(answer, strlen(answer), right_base);
+        size_t points = game_round_submit(&state, right, reaction_time);
+        event_log_answer(events, answered_at, right, points);
+        if (bits == 4)
+            stats_record(stats, left_base, right_base, left, points != 0, reaction_time);
+        COUNTER_END(COUNTER_GAME_SUBMIT);
+
+        COUNTER_BEGIN(COUNTER_GAME_FEEDBACK);
+        if (points == 0) { // answer is replaced by WRONG and why it's not a number if it isn't
+            Line wrong = {0};
+            line_append_literal(&wrong, GP_RED "WRONG" GP_RESET_TERMINAL);
+            if (right == NUMBER_INVALID) {
+                char error[64];
+                line_append_literal(&wrong, " (");
+                line_append(&wrong, error, answer_error(error, sizeof error, answer, strlen(answer), right_base));
+                line_append_literal(&wrong, ")");
+            }
+            renderer->live.length = prompt.length;
+            renderer_keep(renderer, wrong.buffer, wrong.length);
+            COUNTER_END(COUNTER_GAME_FEEDBACK);
+            goto try_again;
+        }
+
+        line.length = 0;
+        if (points == 1)
+            line_append_literal(&line, GP_GREEN "Correct!  +1p " GP_RESET_TERMINAL "(trivial conversion) | Score: ");
+        else
+            line_append_literal(&line, GP_GREEN "Correct!  +2p " GP_RESET_TERMINAL "(non-trivial points) | Score: ");
+        line_append_number(&line, state.score);
+        line_append_literal(&line, " | ");
+        line_append_fixed(&line, reaction_time, 2);
+        line_append_literal(&line, " s");
+        live_publish(live, left_base, right_base, bits, state.score);
+        line_append_live_rank(&line, live);
+        line_append_literal(&line, "\n");
+        renderer_keep(renderer, "", 0);
+        renderer_print(renderer, line.buffer, line.length);
+        COUNTER_END(COUNTER_GAME_FEEDBACK);
+    } // while ( ! timer_expired(&round_timer))
+    COUNTER_SINCE(COUNTER_GAME_LATE, -timer_remaining(&round_timer));
+    COUNTER_BEGIN(COUNTER_GAME_ROUND_END);
+    event_log_round_end(events, clock_now(), state.score);
+
+    #if !_WIN32 // discard partially typed answer
+    if (isatty(STDIN_FILENO))
+        tcflush(STDIN_FILENO, TCIFLUSH);
+    #endif
+    *reaction_ms = game_round_reaction_ms(&state);
+    line.length = 0;
+    line_append_literal(&line, "\nRound ");
+    line_append_number(&line, round);
+    line_append_literal(&line, " score: ");
+    line_append_number(&line, state.score);
+    line_append_literal(&line, "\n");
+    if (state.correct > 0) {
+        line_append_literal(&line, "Mean reaction time: ");
+        line_append_fixed(&line, *reaction_ms / 1000., 2);
+        line_append_literal(&line, " s\n");
+    }
+    line_append_live_ranking(&line, live);
+    line_append_literal(&line, "\n");
+    renderer_print(renderer, line.buffer, line.length);
+    renderer->live.length = 0;
+    renderer_present(renderer);
+    COUNTER_END(COUNTER_GAME_ROUND_END);
+    return state.score;
+}
+
+// --------------------------------
+// Leaderboard Store
+
+// Converts between native and little-endian in both directions, compiles to
+// nothing on little-endian machines.
+static inline uint16_t le16(uint16_t x)
+{
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap16(x);
+    #endif
+    return x;
+}
+
+static inline uint32_t le32(uint32_t x)
+{
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap32(x);
+    #endif
+    return x;
+}
+
+static inline uint64_t le64(uint64_t x)
+{
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+    #endif
+    return x;
+}
+
+// FNV-1a
+static uint32_t leaderboard_hash(const void* data, size_t size)
+{
+    const uint8_t* bytes = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+// Hash of everything after checksum, native byte order.
+static uint32_t leaderboard_checksum(const LeaderBoardSlot* slot)
+{
+    return leaderboard_hash(&slot->length, sizeof*slot - offsetof(LeaderBoardSlot, length));
+}
+
+// Validated in place, so a mapped slot can be read without copying as long as
+// this holds.
+static bool leaderboard_slot_is_valid(const LeaderBoardSlot* slot)
+{
+    return slot->sequence != 0
+        && le32(slot->length)   <= LEADERBOARD_MAX_LENGTH
+        && le32(slot->checksum) == leaderboard_checksum(slot);
+}
+
+static LeaderBoardSlot* leaderboard_slots(const LeaderBoardHeader* header, base_t left_base, base_t right_base)
+{
+    uint64_t offset = le64(header->offsets[left_base][right_base]);
+    gp_assert(offset != 0, "No such round.");
+    return (LeaderBoardSlot*)((char*)header + offset);
+}
+
+// Current contents of a round.
+static const LeaderBoardSlot* leaderboard_round(const LeaderBoard* lb, base_t left_base, base_t right_base)
+{
+    static const LeaderBoardSlot empty = {0};
+    const LeaderBoardSlot* slots = leaderboard_slots(lb->header, left_base, right_base);
+    bool valid0 = leaderboard_slot_is_valid(&slots[0]);
+    bool valid1 = leaderboard_slot_is_valid(&slots[1]);
+
+    if (valid0 && valid1)
+        return le64(slots[0].sequence) > le64(slots[1].sequence) ? &slots[0] : &slots[1];
+    return valid0 ? &slots[0] : valid1 ? &slots[1] : &empty;
+}
+
+// Faster mean reaction time breaks ties of equal scores, unknown is slowest.
+static bool leaderboard_entry_ranks_before(const LeaderBoardEntry* entry, const LeaderBoardEntry* other)
+{
+    if (entry->score != other->score)
+        return le16(entry->score) > le16(other->score);
+    uint32_t reaction_ms = entry->reaction_ms ? le16(entry->reaction_ms) : UINT32_MAX;
+    uint32_t other_ms    = other->reaction_ms ? le16(other->reaction_ms) : UINT32_MAX;
+    return reaction_ms <= other_ms;
+}
+
+// Entries are sorted by descending score and ascending reaction time, complete
+// ties are won by newer entries. Returns LEADERBOARD_MAX_LENGTH if entry does
+// not make it to the leaderboard.
+static size_t leaderboard_position(const LeaderBoardSlot* round, const LeaderBoardEntry* entry)
+{
+    size_t low  = 0;
+    size_t high = le32(round->length);
+    while (low < high) {
+        size_t mid = low + (high - low)/2;
+        if (leaderboard_entry_ranks_before(entry, &round->entries[mid]))
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return low;
+}
+
+// Inserts to round in memory, returns position or LEADERBOARD_MAX_LENGTH.
+static size_t leaderboard_slot_insert(LeaderBoardSlot* round, const LeaderBoardEntry* entry)
+{
+    size_t position = leaderboard_position(round, entry);
+    if (position == LEADERBOARD_MAX_LENGTH)
+        return position;
+
+    size_t length = le32(round->length);
+    if (length < LEADERBOARD_MAX_LENGTH)
+        round->length = le32(++length);
+    memmove(
+        &round->entries[position + 1],
+        &round->entries[position],
+        (length - position - 1) * sizeof round->entries[0]);
+    memcpy(&round->entries[position], entry, sizeof round->entries[0]);
+    return position;
+}
+
+// Fills header and returns file size.
+static size_t leaderboard_layout(LeaderBoardHeader* header)
+{
+    memset(header, 0, sizeof*header);
+    memcpy(header->magic, LEADERBOARD_MAGIC, sizeof header->magic);
+    header->version    = le32(LEADERBOARD_VERSION);
+    header->entry_size = le32(sizeof(LeaderBoardEntry));
+    header->max_length = le32(LEADERBOARD_MAX_LENGTH);
+    header->slot_size  = le32(sizeof(LeaderBoardSlot));
+
+    size_t offset = sizeof*header;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            if (left_base == right_base && left_base != 0) // [0][0] is total
+                continue;
+            else {
+                header->offsets[left_base][right_base] = le64(offset);
+                offset += 2 * sizeof(LeaderBoardSlot);
+            }
+    return offset;
+}
+
+static bool leaderboard_is_valid(const LeaderBoardHeader* header, size_t size)
+{
+    LeaderBoardHeader expected;
+    if (size < leaderboard_layout(&expected))
+        return false;
+    return memcmp(header, &expected, sizeof expected) == 0;
+}
+
+// Version 1 had the same layout as version 2, but in native byte order and with
+// time_t timestamps. Only files written on machines with the same time_t and
+// byte order as ours can be migrated.
+typedef struct leaderboard_entry_v1
+{
+    char     name[16];
+    time_t   timestamp;
+    score_t  score;
+    uint16_t reaction_ms; // padding before version 1
+} LeaderBoardEntryV1;
+
+typedef struct leaderboard_slot_v1
+{
+    uint64_t           sequence;
+    uint32_t           checksum;
+    uint32_t           length;
+    LeaderBoardEntryV1 entries[LEADERBOARD_MAX_LENGTH];
+} LeaderBoardSlotV1;
+
+static void leaderboard_entry_from_v1(LeaderBoardEntry* entry, const LeaderBoardEntryV1* old)
+{
+    memset(entry, 0, sizeof*entry);
+    memcpy(entry->name, old->name, sizeof entry->name);
+    entry->timestamp   = le64(old->timestamp);
+    entry->score       = le16(old->score);
+    entry->reaction_ms = le16(old->reaction_ms);
+}
+
+// Entry of a 4 bit round, false for other widths and invalid records. Version 1
+// records are read if they are as big as current ones, which they are with
+// 64-bit time_t.
+static bool history_record_entry(const HistoryRecord* record, LeaderBoardEntry* entry)
+{
+    if (record->left_base  >= BASE_LENGTH ||
+        record->right_base >= BASE_LENGTH ||
+        (record->left_base == record->right_base && record->left_base != 0) ||
+        (record->bits != 0 && record->bits != 4))
+        return false;
+
+    if (record->version == HISTORY_VERSION)
+        *entry = record->entry;
+    else if (record->version == 1 && sizeof(LeaderBoardEntryV1) == sizeof(LeaderBoardEntry)) {
+        LeaderBoardEntryV1 old;
+        memcpy(&old, &record->entry, sizeof old);
+        leaderboard_entry_from_v1(entry, &old);
+    }
+    else
+        return false;
+    return true;
+}
+
+// Slots are checked when migrated.
+static bool leaderboard_is_v1(const LeaderBoardHeader* header, size_t size)
+{
+    if (size < sizeof*header
+        || memcmp(header->magic, LEADERBOARD_MAGIC, sizeof header->magic) != 0
+        || header->version    != 1
+        || header->entry_size != sizeof(LeaderBoardEntryV1)
+        || header->max_length != LEADERBOARD_MAX_LENGTH
+        || header->slot_size  != sizeof(LeaderBoardSlotV1))
+        return false;
+
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            const uint64_t offset = header->offsets[left_base][right_base];
+            if ((offset == 0) != (left_base == right_base && left_base != 0))
+                return false;
+            if (offset != 0 && (
+                offset < sizeof*header ||
+                offset > size          ||
+                size - offset < 2 * sizeof(LeaderBoardSlotV1) ||
+                offset % _Alignof(LeaderBoardSlotV1) != 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Before version 1, leaderboard.bin was a raw dump of
+// LeaderBoardEntryV1[length][BASE_LENGTH][BASE_LENGTH] with shared length.
+static bool leaderboard_is_v0_dump(size_t size)
+{
+    const size_t row_size = BASE_LENGTH * BASE_LENGTH * sizeof(LeaderBoardEntryV1);
+    return size % row_size == 0 && size / row_size <= LEADERBOARD_MAX_LENGTH;
+}
+
+static char* leaderboard_new_image(size_t* size)
+{
+    LeaderBoardHeader header;
+    *size = leaderboard_layout(&header);
+    char* image = calloc(*size, 1);
+    gp_assert(image != NULL);
+    memcpy(image, &header, sizeof header);
+    return image;
+}
+
+static void leaderboard_image_seal(char* image)
+{
+    const LeaderBoardHeader* header = (const LeaderBoardHeader*)image;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            if (header->offsets[left_base][right_base] == 0)
+                continue;
+            LeaderBoardSlot* slot = leaderboard_slots(header, left_base, right_base);
+            if (slot->length == 0)
+                continue;
+            slot->sequence = le64(1);
+            slot->checksum = le32(leaderboard_checksum(slot));
+        }
+    }
+}
+
+static void leaderboard_image_migrate_v1(char* image, const void* v1)
+{
+    const LeaderBoardHeader* header    = (const LeaderBoardHeader*)image;
+    const LeaderBoardHeader* v1_header = v1;
+
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            if (header->offsets[left_base][right_base] == 0)
+                continue;
+            const LeaderBoardSlotV1* slots = (const LeaderBoardSlotV1*)
+                ((const char*)v1 + v1_header->offsets[left_base][right_base]);
+
+            const LeaderBoardSlotV1* current = NULL;
+            for (size_t i = 0; i < 2; ++i)
+                if (slots[i].sequence != 0
+                    && slots[i].length <= LEADERBOARD_MAX_LENGTH
+                    && slots[i].checksum == leaderboard_hash(
+                        &slots[i].length, sizeof slots[i] - offsetof(LeaderBoardSlotV1, length))
+                    && (current == NULL || slots[i].sequence > current->sequence))
+                    current = &slots[i];
+            if (current == NULL)
+                continue;
+
+            LeaderBoardSlot* slot = leaderboard_slots(header, left_base, right_base);
+            for (size_t i = 0; i < current->length; ++i)
+                leaderboard_entry_from_v1(&slot->entries[i], &current->entries[i]);
+            slot->length = le32(current->length);
+        }
+    }
+}
+
+static void leaderboard_image_migrate_v0(char* image, const void* v0_dump, size_t v0_dump_size)
+{
+    const LeaderBoardHeader* header = (const LeaderBoardHeader*)image;
+    const size_t length = v0_dump_size / (BASE_LENGTH * BASE_LENGTH * sizeof(LeaderBoardEntryV1));
+    const LeaderBoardEntryV1 (*dump)[BASE_LENGTH][BASE_LENGTH] = v0_dump;
+
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            if (header->offsets[left_base][right_base] == 0)
+                continue;
+            LeaderBoardSlot* slot = leaderboard_slots(header, left_base, right_base);
+            for (size_t i = 0; i < length; ++i) {
+                leaderboard_entry_from_v1(&slot->entries[i], &dump[i][left_base][right_base]);
+                slot->entries[i].reaction_ms = 0; // was padding
+            }
+            slot->length = le32(length);
+        }
+    }
+}
+
+// Streams history through the index, O(n log K) for n records.
+static void leaderboard_image_rebuild(char* image, const char* history_path)
+{
+    const LeaderBoardHeader* header = (const LeaderBoardHeader*)image;
+    int fd = open(history_path, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    static HistoryRecord records[1024];
+    ssize_t bytes_read;
+    size_t  leftover = 0;
+    while ((bytes_read = read(fd, (char*)records + leftover, sizeof records - leftover)) > 0)
+    {
+        const size_t length = (leftover + bytes_read) / sizeof records[0];
+        for (size_t i = 0; i < length; ++i) {
+            LeaderBoardEntry entry;
+            if (history_record_entry(&records[i], &entry))
+                leaderboard_slot_insert(
+                    leaderboard_slots(header, records[i].left_base, records[i].right_base), &entry);
+        }
+        leftover = (leftover + bytes_read) % sizeof records[0];
+        memmove(records, (char*)records + length * sizeof records[0], leftover);
+    }
+    if (bytes_read == -1)
+        fprintf(stderr, "hexgame: could not read %s: %s\n", history_path, strerror(errno));
+    gp_assert(close(fd) != -1, strerror(errno));
+}
+
+// Images are built in memory and moved to path, so readers never see a
+// partially written file. Fresh files never replace existing ones, someone else
+// might have created and already used it.
+static bool leaderboard_create(const char* path, char* image, size_t size, bool replace)
+{
+    leaderboard_image_seal(image);
+
+    char tmp_path[4096 + 32];
+    snprintf(tmp_path, sizeof tmp_path, "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    bool success = fd != -1
+        && write(fd, image, size) == (ssize_t)size
+        #if !_WIN32
+        && fsync(fd) != -1
+        #endif
+        ;
+    if (fd != -1)
+        success = close(fd) != -1 && success;
+
+    #if _WIN32 // rename() does not replace existing files
+    if (replace)
+        remove(path);
+    success = success && rename(tmp_path, path) != -1;
+    #else
+    if ( ! replace)
+        success = success && (link(tmp_path, path) != -1 || errno == EEXIST);
+    else
+        success = success && rename(tmp_path, path) != -1;
+    #endif
+
+    if ( ! success)
+        fprintf(stderr, "hexgame: could not create %s: %s\n", path, strerror(errno));
+    remove(tmp_path);
+    free(image);
+    return success;
+}
+
+static void* leaderboard_map(int fd, size_t size)
+{
+    #if _WIN32
+    void* image = malloc(size);
+    if (image != NULL && (lseek(fd, 0, SEEK_SET) == -1 || read(fd, image, size) != (ssize_t)size)) {
+        free(image);
+        image = NULL;
+    }
+    return image;
+    #else
+    void* image = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return image == MAP_FAILED ? NULL : image;
+    #endif
+}
+
+static void leaderboard_unmap(void* image, size_t size)
+{
+    #if _WIN32
+    (void)size;
+    free(image);
+    #else
+    gp_assert(munmap(image, size) != -1, strerror(errno));
+    #endif
+}
+
+// Advisory record lock for serializing writers across processes. Readers don't
+// lock, they rely on checksums instead. The OS releases locks of dead processes
+// and when fd gets closed. Windows has no concurrent updates.
+static void leaderboard_lock_range(int fd, size_t start, size_t length, bool lock)
+{
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_LOCK);
+    #if _WIN32
+    (void)fd; (void)start; (void)length; (void)lock;
+    #else
+    struct flock fl = {
+        .l_type   = lock ? F_WRLCK : F_UNLCK,
+        .l_whence = SEEK_SET,
+        .l_start  = start,
+        .l_len    = length, // 0 for whole file
+    };
+    while (fcntl(fd, F_SETLKW, &fl) == -1)
+        if (errno != EINTR) {
+            fprintf(stderr, "hexgame: could not lock leaderboard: %s\n", strerror(errno));
+            break;
+        }
+    #endif
+}
+
+// Writes changes in mapped range to disk.
+static void leaderboard_sync(const LeaderBoard* lb, const void* start, size_t size)
+{
+    if (lb->fd == -1)
+        return;
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_SYNC);
+    #if _WIN32
+    if (lseek(lb->fd, (const char*)start - (const char*)lb->header, SEEK_SET) == -1 ||
+        write(lb->fd, start, size) != (ssize_t)size)
+    #else
+    const uintptr_t page  = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t)start & ~(page - 1);
+    if (msync((void*)begin, (uintptr_t)start + size - begin, MS_SYNC) == -1)
+    #endif
+        fprintf(stderr, "hexgame: could not save leaderboard: %s\n", strerror(errno));
+}
+
+// Opens leaderboard.bin and history.bin in directory dir creating or migrating
+// them if needed. If dir is NULL or the files cannot be used, leaderboard will
+// be kept in memory only.
+static void leaderboard_open(LeaderBoard* lb, const char* dir)
+{
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_OPEN);
+    *lb = (LeaderBoard){ .fd = -1, .history_fd = -1, .stats_fd = -1, .schedule_fd = -1 };
+    char path[4096];
+    char history_path[4096];
+    char stats_path[4096];
+    char schedule_path[4096];
+    if (dir != NULL) {
+        snprintf(path,          sizeof path,          "%s/leaderboard.bin", dir);
+        snprintf(history_path,  sizeof history_path,  "%s/history.bin",     dir);
+        snprintf(stats_path,    sizeof stats_path,    "%s/stats.bin",       dir);
+        snprintf(schedule_path, sizeof schedule_path, "%s/schedule.bin",    dir);
+        if ((lb->history_fd = open(history_path, O_WRONLY | O_APPEND | O_CREAT, 0644)) == -1)
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", history_path, strerror(errno));
+        if ((lb->stats_fd = open(stats_path, O_RDWR | O_CREAT, 0644)) == -1)
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", stats_path, strerror(errno));
+        if ((lb->schedule_fd = open(schedule_path, O_RDWR | O_CREAT, 0644)) == -1)
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", schedule_path, strerror(errno));
+    }
+
+    for (size_t attempt = 0; dir != NULL && attempt < 2; ++attempt)
+    {
+        struct stat st;
+        size_t image_size;
+        char*  image;
+        if ((lb->fd = open(path, O_RDWR)) == -1) {
+            if (errno == ENOENT && attempt == 0) {
+                image = leaderboard_new_image(&image_size);
+                leaderboard_image_rebuild(image, history_path);
+                if (leaderboard_create(path, image, image_size, false))
+                    continue;
+            }
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+            break;
+        }
+        gp_assert(fstat(lb->fd, &st) != -1, strerror(errno));
+        lb->size   = st.st_size;
+        lb->header = lb->size == 0 ? NULL : leaderboard_map(lb->fd, lb->size);
+
+        if (lb->header != NULL && leaderboard_is_valid(lb->header, lb->size))
+            return;
+
+        bool migrated = false;
+        const bool v1 = lb->header != NULL && leaderboard_is_v1(lb->header, lb->size);
+        if (attempt == 0 && (v1 || (leaderboard_is_v0_dump(lb->size) && (lb->header != NULL || lb->size == 0))))
+        {
+            // Someone else might be migrating too. The lock gets released
+            // when the old file gets closed.
+            leaderboard_lock_range(lb->fd, 0, 0, true);
+            #if !_WIN32
+            struct stat path_st;
+            if (stat(path, &path_st) == 0 && path_st.st_ino != st.st_ino)
+                migrated = true;
+            else
+            #endif
+            {
+                image = leaderboard_new_image(&image_size);
+                if (v1)
+                    leaderboard_image_migrate_v1(image, lb->header);
+                else
+                    leaderboard_image_migrate_v0(image, lb->header, lb->size);
+                migrated = leaderboard_create(path, image, image_size, true);
+            }
+        }
+        else
+            fprintf(stderr, "hexgame: %s is not a valid leaderboard file.\n", path);
+
+        if (lb->header != NULL)
+            leaderboard_unmap(lb->header, lb->size);
+        gp_assert(close(lb->fd) != -1, strerror(errno));
+        lb->header = NULL;
+        lb->fd     = -1;
+        if ( ! migrated)
+            break;
+    }
+
+    // Not backed by file
+    lb->header = (LeaderBoardHeader*)leaderboard_new_image(&lb->size);
+}
+
+static void leaderboard_close(LeaderBoard* lb)
+{
+    if (lb->fd == -1)
+        free(lb->header);
+    else {
+        leaderboard_unmap(lb->header, lb->size);
+        gp_assert(close(lb->fd) != -1, strerror(errno));
+    }
+    if (lb->history_fd != -1)
+        gp_assert(close(lb->history_fd) != -1, strerror(errno));
+    if (lb->stats_fd != -1)
+        gp_assert(close(lb->stats_fd) != -1, strerror(errno));
+    if (lb->schedule_fd != -1)
+        gp_assert(close(lb->schedule_fd) != -1, strerror(errno));
+    *lb = (LeaderBoard){ .fd = -1, .history_fd = -1, .stats_fd = -1, .schedule_fd = -1 };
+}
+
+#define STATS_MAGIC      "HEXSTAT"
+#define STATS_VERSION    1
+#define SCHEDULE_MAGIC   "HEXSCHD"
+#define SCHEDULE_VERSION 1
+
+typedef struct state_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t size; // of contents
+} StateHeader;
+
+// stats.bin and schedule.bin are StateHeader followed by a struct, rewritten in
+// place when updated. They are not critical, so invalid files are just started
+// over. Returns false if contents were not valid. The file must be locked.
+static bool leaderboard_read_state_locked(int fd, const char* magic, uint32_t version, void* contents, uint32_t size)
+{
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_STATE);
+    StateHeader header;
+    StateHeader expected = { .version = version, .size = size };
+    memcpy(expected.magic, magic, sizeof expected.magic);
+    return lseek(fd, 0, SEEK_SET) == 0
+        && read(fd, &header, sizeof header) == sizeof header
+        && memcmp(&header, &expected, sizeof header) == 0
+        && read(fd, contents, size) == size;
+}
+
+static void leaderboard_write_state_locked(int fd, const char* magic, uint32_t version, const void* contents, uint32_t size)
+{
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_STATE);
+    StateHeader header = { .version = version, .size = size };
+    memcpy(header.magic, magic, sizeof header.magic);
+    if (lseek(fd, 0, SEEK_SET) != 0
+        || write(fd, &header, sizeof header) != sizeof header
+        || write(fd, contents, size) != size)
+        fprintf(stderr, "hexgame: could not save %s: %s\n", magic, strerror(errno));
+}
+
+// Not thread safe, uses file offset of stats_fd.
+static void leaderboard_load_stats(const LeaderBoard* lb, Stats* stats)
+{
+    if (lb->stats_fd == -1) {
+        memset(stats, 0, sizeof*stats);
+        return;
+    }
+    leaderboard_lock_range(lb->stats_fd, 0, 0, true);
+    if ( ! leaderboard_read_state_locked(lb->stats_fd, STATS_MAGIC, STATS_VERSION, stats, sizeof*stats))
+        memset(stats, 0, sizeof*stats);
+    leaderboard_lock_range(lb->stats_fd, 0, 0, false);
+}
+
+// Not thread safe, uses static buffer and file offset of stats_fd.
+static void leaderboard_add_stats(LeaderBoard* lb, const Stats* stats)
+{
+    if (lb->stats_fd == -1)
+        return;
+    static Stats total; // too big for stack of server threads
+
+    leaderboard_lock_range(lb->stats_fd, 0, 0, true);
+    if ( ! leaderboard_read_state_locked(lb->stats_fd, STATS_MAGIC, STATS_VERSION, &total, sizeof total))
+        memset(&total, 0, sizeof total);
+    stats_add(&total, stats);
+    leaderboard_write_state_locked(lb->stats_fd, STATS_MAGIC, STATS_VERSION, &total, sizeof total);
+    leaderboard_lock_range(lb->stats_fd, 0, 0, false);
+}
+
+// Returns schedule decayed to now.
+static void leaderboard_load_schedule(const LeaderBoard* lb, Schedule* schedule, time_t now)
+{
+    bool valid = false;
+    if (lb->schedule_fd != -1) {
+        leaderboard_lock_range(lb->schedule_fd, 0, 0, true);
+        valid = leaderboard_read_state_locked(
+            lb->schedule_fd, SCHEDULE_MAGIC, SCHEDULE_VERSION, schedule, sizeof*schedule);
+        leaderboard_lock_range(lb->schedule_fd, 0, 0, false);
+    }
+    if ( ! valid)
+        schedule_init(schedule);
+    schedule_decay(schedule, now);
+}
+
+// Learns from stats of a session. Reloaded in case other sessions finished
+// while this was played.
+static void leaderboard_update_schedule(LeaderBoard* lb, const Stats* session, time_t now)
+{
+    if (lb->schedule_fd == -1)
+        return;
+    Schedule schedule;
+    leaderboard_lock_range(lb->schedule_fd, 0, 0, true);
+    if ( ! leaderboard_read_state_locked(
+        lb->schedule_fd, SCHEDULE_MAGIC, SCHEDULE_VERSION, &schedule, sizeof schedule))
+        schedule_init(&schedule);
+    schedule_decay(&schedule, now);
+    schedule_learn(&schedule, session);
+    leaderboard_write_state_locked(lb->schedule_fd, SCHEDULE_MAGIC, SCHEDULE_VERSION, &schedule, sizeof schedule);
+    leaderboard_lock_range(lb->schedule_fd, 0, 0, false);
+}
+
+// Appends results to history in a single write(), which O_APPEND makes atomic
+// with respect to other processes appending.
+static void leaderboard_record(LeaderBoard* lb, const HistoryRecord* records, size_t length)
+{
+    if (lb->history_fd == -1)
+        return;
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_HISTORY);
+    if (write(lb->history_fd, records, length * sizeof records[0]) != (ssize_t)(length * sizeof records[0]))
+        fprintf(stderr, "hexgame: could not write history: %s\n", strerror(errno));
+}
+
+// Writes new contents of a round to the non-current slot. Round must be locked.
+// Returns the written slot, which is not yet synced to disk.
+static const LeaderBoardSlot* leaderboard_commit(
+    LeaderBoard* lb, base_t left_base, base_t right_base, LeaderBoardSlot* new_round)
+{
+    LeaderBoardSlot* slots = leaderboard_slots(lb->header, left_base, right_base);
+    const LeaderBoardSlot* current = leaderboard_round(lb, left_base, right_base);
+    LeaderBoardSlot* next = current == &slots[0] ? &slots[1] : &slots[0];
+
+    new_round->sequence = le64(le64(current->sequence) + 1);
+    new_round->checksum = le32(leaderboard_checksum(new_round));
+    memcpy(next, new_round, sizeof*next);
+    return next;
+}
+
+// Returns position of inserted entry or LEADERBOARD_MAX_LENGTH if not inserted.
+// The written slot is synced before unlocking, otherwise the next writer could
+// overwrite the only synced slot while the new one is still in page cache. The
+// slot is a single page or two, so the lock is held briefly.
+static size_t leaderboard_insert(
+    LeaderBoard* lb, base_t left_base, base_t right_base, const LeaderBoardEntry* entry)
+{
+    COUNTER_SCOPE(COUNTER_LEADERBOARD_INSERT);
+    // Scores on a full leaderboard only get better, so no need to lock if this
+    // one does not fit even now.
+    if (leaderboard_position(leaderboard_round(lb, left_base, right_base), entry)
+        == LEADERBOARD_MAX_LENGTH)
+        return LEADERBOARD_MAX_LENGTH;
+
+    const size_t round_offset = le64(lb->header->offsets[left_base][right_base]);
+    const size_t round_size   = 2 * sizeof(LeaderBoardSlot);
+    if (lb->fd != -1)
+        leaderboard_lock_range(lb->fd, round_offset, round_size, true);
+
+    LeaderBoardSlot new_round;
+    memcpy(&new_round, leaderboard_round(lb, left_base, right_base), sizeof new_round);
+
+    size_t position = leaderboard_slot_insert(&new_round, entry);
+    if (position == LEADERBOARD_MAX_LENGTH) {
+        if (lb->fd != -1)
+            leaderboard_lock_range(lb->fd, round_offset, round_size, false);
+        return position;
+    }
+
+    const LeaderBoardSlot* written = leaderboard_commit(lb, left_base, right_base, &new_round);
+    leaderboard_sync(lb, written, sizeof*written);
+    if (lb->fd != -1)
+        leaderboard_lock_range(lb->fd, round_offset, round_size, false);
+    return position;
+}
+
+// Records results of a session to history and, if played with 4 bits, to
+// leaderboard. Returns the number of new high scores stored to new_high_scores.
+// Reaction time of total is the mean of rounds with correct answers.
+static size_t leaderboard_submit(
+    LeaderBoard*      lb,
+    unsigned          bits,
+    uint32_t          seed, // of session, 0 if unknown
+    score_t           scores[BASE_LENGTH][BASE_LENGTH],
+    uint16_t          reactions_ms[BASE_LENGTH][BASE_LENGTH],
+    const char*       name,
+    time_t            timestamp,
+    HighScorePosition new_high_scores[BASE_COMBINATIONS + 1]) // +1 for total
+{
+    uint32_t reaction_sum    = 0;
+    uint32_t reaction_rounds = 0;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            if (left_base != right_base && reactions_ms[left_base][right_base] != 0) {
+                reaction_sum    += reactions_ms[left_base][right_base];
+                reaction_rounds += 1;
+            }
+    reactions_ms[0][0] = reaction_rounds ? (reaction_sum + reaction_rounds/2) / reaction_rounds : 0;
+
+    HistoryRecord records[BASE_COMBINATIONS + 1];
+    size_t records_length = 0;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            if (left_base == right_base && left_base != 0)
+                continue;
+            HistoryRecord* record = &records[records_length++];
+            memset(record, 0, sizeof*record); // no garbage padding to checksums
+            record->version           = HISTORY_VERSION;
+            record->left_base         = left_base;
+            record->right_base        = right_base;
+            record->bits              = bits;
+            strncpy(record->entry.name, name, sizeof record->entry.name);
+            record->entry.timestamp   = le64(timestamp);
+            record->entry.score       = le16(scores[left_base][right_base]);
+            record->entry.reaction_ms = le16(reactions_ms[left_base][right_base]);
+            record->entry.seed        = le32(seed);
+        }
+    }
+    leaderboard_record(lb, records, records_length);
+    if (bits != 4)
+        return 0;
+
+    // Only changed rounds are written, positions may have changed if someone
+    // else updated the leaderboard while we were playing.
+    size_t new_high_scores_length = 0;
+    for (size_t i = 0; i < records_length; ++i) {
+        size_t position = leaderboard_insert(
+            lb, records[i].left_base, records[i].right_base, &records[i].entry);
+        if (position < LEADERBOARD_MAX_LENGTH)
+            new_high_scores[new_high_scores_length++] = (HighScorePosition)
+                { records[i].left_base, records[i].right_base, position };
+    }
+    return new_high_scores_length;
+}
+
+static void print_score(
+    score_t  score,
+    uint16_t reaction_ms,
+    base_t   left_base,
+    base_t   right_base,
+    int      high_score_rank)
+{
+    char round_name[128];
+
+    size_t longest = 0;
+    for (size_t base = 0; base < BASE_LENGTH; ++base)
+        if (strlen(base_lowercase[base]) > longest)
+            longest = strlen(base_lowercase[base]);
+    const int round_name_width = 2*longest + (sizeof" to "-1);
+
+    if (left_base == 0 && right_base == 0)
+        strcpy(round_name, "All Rounds Total");
+    else
+        strcat(strcat(strcpy(
+            round_name, base_titlecase[left_base]), " to "), base_titlecase[right_base]);
+
+    printf("%-*s : %*zu ", round_name_width, round_name, SCORE_FIELD_WIDTH, (size_t)score);
+    if (reaction_ms != 0)
+        printf("%*.2f s ", REACTION_FIELD_WIDTH - 2, reaction_ms / 1000.);
+    else
+        printf("%*s ", REACTION_FIELD_WIDTH, "-");
+    if (high_score_rank) {
+        printf("(top %i!) ", high_score_rank);
+        const char* medals[] = {"", "🥇", "🥈", "🥉"};
+        if (high_score_rank <= 3)
+            printf("%s", medals[high_score_rank]);
+    }
+    puts("");
+}
+
+static void print_stats(const Stats* stats)
+{
+    puts("\n-----------------------------------------------------------------");
+    puts("    HEXGAME STATISTICS");
+    puts("-----------------------------------------------------------------\n");
+
+    size_t round = 0;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+    {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+        {
+            if (left_base == right_base)
+                continue;
+            puts("-----------------------------------------------------------------");
+            printf("Round %zu: %s to %s\n", ++round, base_titlecase[left_base], base_titlecase[right_base]);
+            printf("%8s | %8s | %8s | %8s | %8s | %s\n",
+                "Question", "Correct", "Wrong", "Accuracy", "Median", "90th");
+            puts("-----------------------------------------------------------------");
+
+            for (uint32_t question = 0; question <= 0xF; ++question)
+            {
+                const NibbleStats* nibble = &stats->nibbles[round_index(left_base, right_base)][question];
+                char shown[NUMBER_BUFFER_SIZE];
+                format_number(shown, question, left_base, 4);
+                printf("%8s | %8u | %8u | ", shown, (unsigned)nibble->correct, (unsigned)nibble->wrong);
+                if (nibble->correct + nibble->wrong == 0) {
+                    printf("%8s | %8s | %s\n", "-", "-", "-");
+                    continue;
+                }
+                printf("%6.0f %% | ", 100. * nibble->correct / (nibble->correct + nibble->wrong));
+                if (nibble->correct == 0)
+                    printf("%8s | %s\n", "-", "-");
+                else
+                    printf("%6.2f s | %.2f s\n",
+                        stats_latency_percentile(nibble, .5), stats_latency_percentile(nibble, .9));
+            }
+            puts("-----------------------------------------------------------------");
+            puts("");
+        }
+    }
+}
+
+// --------------------------------
+// Leaderboard Queries
+//
+// Top ten of every round come straight from the index in leaderboard.bin. Other
+// queries scan history.bin mapped to memory keeping the best matches of each
+// round in a heap. Rows are assembled to Lines and written out in big chunks.
+
+typedef enum query_format
+{
+    QUERY_TEXT,
+    QUERY_CSV,
+    QUERY_JSON
+} QueryFormat;
+
+typedef struct leaderboard_query
+{
+    bool        rounds[BASE_LENGTH][BASE_LENGTH]; // [0][0] for total, none for all
+    int64_t     since; // INT64_MIN for all
+    const char* name;  // NULL for all
+    size_t      top;
+    QueryFormat format;
+} LeaderBoardQuery;
+
+static const char* round_names[BASE_LENGTH][BASE_LENGTH] = {
+    [BASE2]  = { [BASE2] = "total",   [BASE10] = "bin2dec", [BASE16] = "bin2hex" },
+    [BASE10] = { [BASE2] = "dec2bin", [BASE16] = "dec2hex" },
+    [BASE16] = { [BASE2] = "hex2bin", [BASE10] = "hex2dec" },
+};
+
+static bool query_parse_round(LeaderBoardQuery* query, const char* name)
+{
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            if (round_names[left_base][right_base] != NULL &&
+                strcmp(name, round_names[left_base][right_base]) == 0)
+                return query->rounds[left_base][right_base] = true;
+    return false;
+}
+
+// YYYY-MM-DD or YYYY-MM-DDTHH:MM[:SS] in local time.
+static bool query_parse_date(const char* str, int64_t* timestamp)
+{
+    struct tm tm = { .tm_isdst = -1 };
+    int length = 0;
+    if (sscanf(str, "%4d-%2d-%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &length) != 3)
+        return false;
+    if (str[length] == 'T' || str[length] == ' ') {
+        int time_length = 0;
+        if (sscanf(&str[length + 1], "%2d:%2d%n:%2d%n",
+            &tm.tm_hour, &tm.tm_min, &time_length, &tm.tm_sec, &time_length) < 2)
+            return false;
+        length += 1 + time_length;
+    }
+    if (str[length] != '\0'
+        || tm.tm_mon  < 1 || tm.tm_mon  > 12
+        || tm.tm_mday < 1 || tm.tm_mday > 31
+        || tm.tm_hour > 23 || tm.tm_min > 59 || tm.tm_sec > 60)
+        return false;
+    tm.tm_year -= 1900;
+    tm.tm_mon  -= 1;
+    time_t t = mktime(&tm);
+    *timestamp = t;
+    return t != (time_t)-1;
+}
+
+// Larger keys rank first: higher score, faster reaction with unknown slowest,
+// and newer record, like in leaderboard_entry_ranks_before().
+static uint64_t query_key(const LeaderBoardEntry* entry, uint32_t record)
+{
+    const uint32_t reaction_ms = entry->reaction_ms ? le16(entry->reaction_ms) : 0x10000;
+    return (uint64_t)le16(entry->score) << 48 | (uint64_t)(0x10000 - reaction_ms) << 32 | record;
+}
+
+// Min-heap of the top keys seen so far, worst at root.
+typedef struct query_heap
+{
+    uint64_t* keys;
+    size_t    length;
+    size_t    capacity;
+} QueryHeap;
+
+static void query_heap_offer(QueryHeap* heap, size_t top, uint64_t key)
+{
+    if (heap->length < top) {
+        if (heap->length == heap->capacity) {
+            heap->capacity = heap->capacity ? 2 * heap->capacity : 16;
+            heap->keys = realloc(heap->keys, heap->capacity * sizeof heap->keys[0]);
+            gp_assert(heap->keys != NULL);
+        }
+        size_t i = heap->length++;
+        for (; i > 0 && heap->keys[(i - 1)/2] > key; i = (i - 1)/2)
+            heap->keys[i] = heap->keys[(i - 1)/2];
+        heap->keys[i] = key;
+    }
+    else if (heap->length > 0 && key > heap->keys[0]) {
+        size_t i = 0;
+        for (size_t child; (child = 2*i + 1) < heap->length; i = child) {
+            if (child + 1 < heap->length && heap->keys[child + 1] < heap->keys[child])
+                ++child;
+            if (heap->keys[child] >= key)
+                break;
+            heap->keys[i] = heap->keys[child];
+        }
+        heap->keys[i] = key;
+    }
+}
+
+static int query_key_compare_descending(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x < y) - (x > y);
+}
+
+// Fills rows of selected rounds from history, returns false if it could not be
+// read. Rows are allocated with malloc().
+static bool query_history(
+    const char*             history_path,
+    const LeaderBoardQuery* query,
+    LeaderBoardEntry*       rows[BASE_LENGTH][BASE_LENGTH],
+    size_t                  lengths[BASE_LENGTH][BASE_LENGTH])
+{
+    int fd = open(history_path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "hexgame: cannot open %s: %s\n", history_path, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return false;
+    }
+    const size_t size   = st.st_size;
+    const size_t length = size / sizeof(HistoryRecord);
+    gp_assert(length <= UINT32_MAX, "History too long for query keys.");
+
+    const HistoryRecord* records = NULL;
+    if (length > 0) {
+        #if _WIN32
+        void* image = malloc(size);
+        if (image != NULL && read(fd, image, size) != (ssize_t)size) {
+            free(image);
+            image = NULL;
+        }
+        #else
+        void* image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (image == MAP_FAILED)
+            image = NULL;
+        #endif
+        if (image == NULL) {
+            fprintf(stderr, "hexgame: could not read %s: %s\n", history_path, strerror(errno));
+            close(fd);
+            return false;
+        }
+        records = image;
+    }
+    gp_assert(close(fd) != -1, strerror(errno));
+
+    QueryHeap heaps[BASE_LENGTH][BASE_LENGTH] = {0};
+    for (size_t i = 0; i < length; ++i) {
+        const HistoryRecord* record = &records[i];
+        LeaderBoardEntry entry;
+        if (record->left_base >= BASE_LENGTH || record->right_base >= BASE_LENGTH
+            || ! query->rounds[record->left_base][record->right_base]
+            || ! history_record_entry(record, &entry)
+            || (int64_t)le64(entry.timestamp) < query->since
+            || (query->name != NULL && strncmp(entry.name, query->name, sizeof entry.name) != 0))
+            continue;
+        query_heap_offer(&heaps[record->left_base][record->right_base], query->top, query_key(&entry, i));
+    }
+
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            QueryHeap* heap = &heaps[left_base][right_base];
+            if (heap->length > 0)
+                qsort(heap->keys, heap->length, sizeof heap->keys[0], query_key_compare_descending);
+            rows[left_base][right_base] = malloc(heap->length * sizeof(LeaderBoardEntry) + 1);
+            gp_assert(rows[left_base][right_base] != NULL);
+            for (size_t i = 0; i < heap->length; ++i)
+                history_record_entry(&records[(uint32_t)heap->keys[i]], &rows[left_base][right_base][i]);
+            lengths[left_base][right_base] = heap->length;
+            free(heap->keys);
+        }
+    }
+
+    if (records != NULL) {
+        #if _WIN32
+        free((void*)records);
+        #else
+        gp_assert(munmap((void*)records, size) != -1, strerror(errno));
+        #endif
+    }
+    return true;
+}
+
+typedef struct writer
+{
+    FILE*  out;
+    size_t length;
+    char   buffer[1 << 16];
+} Writer;
+
+static void writer_flush(Writer* writer)
+{
+    fwrite(writer->buffer, 1, writer->length, writer->out);
+    writer->length = 0;
+}
+
+static void writer_write(Writer* writer, const char* str, size_t length)
+{
+    if (writer->length + length > sizeof writer->buffer)
+        writer_flush(writer);
+    gp_assert(length <= sizeof writer->buffer, length);
+    memcpy(&writer->buffer[writer->length], str, length);
+    writer->length += length;
+}
+
+#define writer_write_literal(WRITER, LITERAL) writer_write(WRITER, LITERAL, sizeof(LITERAL) - sizeof"")
+
+// Sessions write all their records with the same timestamp and good sessions
+// rank close to each other, so there are way less distinct timestamps than rows
+// and formatting dates is slow.
+typedef struct date_cache_entry
+{
+    int64_t timestamp;
+    uint8_t length; // 0 for empty
+    char    date[55];
+} DateCacheEntry;
+
+typedef struct date_cache
+{
+    const char*    format;
+    DateCacheEntry entries[64];
+} DateCache;
+
+static void line_append_date(Line* line, DateCache* cache, int64_t timestamp)
+{
+    const size_t    capacity = sizeof cache->entries / sizeof cache->entries[0];
+    DateCacheEntry* entry    = &cache->entries[(uint64_t)timestamp % capacity];
+    if (entry->length == 0 || entry->timestamp != timestamp) {
+        const time_t t = timestamp;
+        #if _WIN32
+        struct tm* tm = localtime(&t);
+        #else // localtime() checks for time zone changes every call
+        struct tm  tm_buffer;
+        struct tm* tm = localtime_r(&t, &tm_buffer);
+        #endif
+        gp_assert(tm != NULL, timestamp);
+        entry->timestamp = timestamp;
+        entry->length    = strftime(entry->date, sizeof entry->date, cache->format, tm);
+        gp_assert(entry->length != 0);
+    }
+    line_append(line, entry->date, entry->length);
+}
+
+// Pads what was appended after start to width like printf("%-*s").
+static void line_append_padding(Line* line, size_t start, size_t width)
+{
+    static const char spaces[] = "                ";
+    const size_t length = line->length - start;
+    gp_assert(width < sizeof spaces, width);
+    if (length < width)
+        line_append(line, spaces, width - length);
+}
+
+static void line_append_csv(Line* line, const char* str, size_t length)
+{
+    bool quote = false;
+    for (size_t i = 0; i < length; ++i)
+        quote |= str[i] == ',' || str[i] == '"' || str[i] == '\r' || str[i] == '\n';
+    if ( ! quote) {
+        line_append(line, str, length);
+        return;
+    }
+    line_append_literal(line, "\"");
+    for (size_t i = 0; i < length; ++i)
+        if (str[i] == '"')
+            line_append_literal(line, "\"\"");
+        else
+            line_append(line, &str[i], 1);
+    line_append_literal(line, "\"");
+}
+
+static void line_append_json(Line* line, const char* str, size_t length)
+{
+    line_append_literal(line, "\"");
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t c = str[i];
+        if (c == '"' || c == '\\') {
+            line_append_literal(line, "\\");
+            line_append(line, &str[i], 1);
+        } else if (c < 0x20) {
+            line_append_literal(line, "\\u00");
+            line_append(line, &hex_digits[2 * c], 2);
+        } else
+            line_append(line, &str[i], 1);
+    }
+    line_append_literal(line, "\"");
+}
+
+static void query_write_row(
+    Writer*                 writer,
+    DateCache*              dates,
+    QueryFormat             format,
+    base_t                  left_base,
+    base_t                  right_base,
+    size_t                  rank,
+    const LeaderBoardEntry* entry)
+{
+    const size_t   name_length = strnlen(entry->name, sizeof entry->name);
+    const uint16_t reaction_ms = le16(entry->reaction_ms);
+    const int64_t  timestamp   = le64(entry->timestamp);
+    Line   line  = {0};
+    size_t start = 0;
+    switch (format) {
+    case QUERY_TEXT:
+        if (rank < 10)
+            line_append_literal(&line, " ");
+        line_append_number(&line, rank);
+        line_append_literal(&line, " | ");
+        line_append(&line, entry->name, name_length);
+        line_append_padding(&line, line.length - name_length, sizeof entry->name - sizeof"");
+        line_append_literal(&line, " | ");
+        start = line.length;
+        line_append_number(&line, le16(entry->score));
+        line_append_padding(&line, start, SCORE_FIELD_WIDTH);
+        line_append_literal(&line, " | ");
+        start = line.length;
+        if (reaction_ms == 0)
+            line_append_literal(&line, "-");
+        else {
+            line_append_fixed(&line, reaction_ms / 1000., 2);
+            line_append_literal(&line, " s");
+        }
+        line_append_padding(&line, start, REACTION_FIELD_WIDTH);
+        line_append_literal(&line, " | ");
+        line_append_date(&line, dates, timestamp);
+        line_append_literal(&line, "\n");
+        break;
+
+    case QUERY_CSV:
+        line_append(&line, round_names[left_base][right_base], strlen(round_names[left_base][right_base]));
+        line_append_literal(&line, ",");
+        line_append_number(&line, rank);
+        line_append_literal(&line, ",");
+        line_append_csv(&line, entry->name, name_length);
+        line_append_literal(&line, ",");
+        line_append_number(&line, le16(entry->score));
+        line_append_literal(&line, ",");
+        if (reaction_ms != 0)
+            line_append_number(&line, reaction_ms);
+        line_append_literal(&line, ",");
+        line_append_date(&line, dates, timestamp);
+        line_append_literal(&line, ",");
+        if (entry->seed != 0)
+            line_append_number(&line, le32(entry->seed));
+        line_append_literal(&line, "\n");
+        break;
+
+    case QUERY_JSON:
+        line_append_literal(&line, "  {\"round\": \"");
+        line_append(&line, round_names[left_base][right_base], strlen(round_names[left_base][right_base]));
+        line_append_literal(&line, "\", \"rank\": ");
+        line_append_number(&line, rank);
+        line_append_literal(&line, ", \"name\": ");
+        line_append_json(&line, entry->name, name_length);
+        line_append_literal(&line, ", \"score\": ");
+        line_append_number(&line, le16(entry->score));
+        line_append_literal(&line, ", \"reaction_ms\": ");
+        if (reaction_ms != 0)
+            line_append_number(&line, reaction_ms);
+        else
+            line_append_literal(&line, "null");
+        line_append_literal(&line, ", \"date\": \"");
+        line_append_date(&line, dates, timestamp);
+        line_append_literal(&line, "\", \"seed\": ");
+        if (entry->seed != 0)
+            line_append_number(&line, le32(entry->seed));
+        else
+            line_append_literal(&line, "null");
+        line_append_literal(&line, "}");
+        break;
+    }
+    writer_write(writer, line.buffer, line.length);
+}
+
+static void query_write_round_header(Writer* writer, base_t left_base, base_t right_base, size_t round)
+{
+    Line line = {0};
+    line_append_literal(&line, "-----------------------------------------------------------------\n");
+    if (left_base == 0 && right_base == 0)
+        line_append_literal(&line, "All Rounds Total\n");
+    else {
+        line_append_literal(&line, "Round ");
+        line_append_number(&line, round);
+        line_append_literal(&line, ": ");
+        line_append(&line, base_titlecase[left_base], strlen(base_titlecase[left_base]));
+        line_append_literal(&line, " to ");
+        line_append(&line, base_titlecase[right_base], strlen(base_titlecase[right_base]));
+        line_append_literal(&line, "\n");
+    }
+    line_append_literal(&line, "   | Name            | Score    | Reaction | Date\n");
+    line_append_literal(&line, "-----------------------------------------------------------------\n");
+    writer_write(writer, line.buffer, line.length);
+}
+
+// Answers from leaderboard.bin if it has all asked entries, otherwise from
+// history at history_path if it is not NULL.
+static void print_leaderboard_query(
+    const LeaderBoard* leaderboard, const char* history_path, LeaderBoardQuery query)
+{
+    bool any_round = false;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            any_round |= query.rounds[left_base][right_base];
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            query.rounds[left_base][right_base] |= ! any_round && round_names[left_base][right_base] != NULL;
+
+    LeaderBoardEntry* rows[BASE_LENGTH][BASE_LENGTH]    = {0};
+    size_t            lengths[BASE_LENGTH][BASE_LENGTH] = {0};
+    const bool indexed = query.name == NULL && query.since == INT64_MIN && query.top <= LEADERBOARD_MAX_LENGTH;
+    if (indexed || history_path == NULL || ! query_history(history_path, &query, rows, lengths)) {
+        for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+            for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+                if ( ! query.rounds[left_base][right_base])
+                    continue;
+                const LeaderBoardSlot* round = leaderboard_round(leaderboard, left_base, right_base);
+                lengths[left_base][right_base] = gp_min((size_t)le32(round->length), query.top);
+                rows[left_base][right_base] = malloc(lengths[left_base][right_base] * sizeof(LeaderBoardEntry) + 1);
+                gp_assert(rows[left_base][right_base] != NULL);
+                memcpy(rows[left_base][right_base], round->entries,
+                    lengths[left_base][right_base] * sizeof(LeaderBoardEntry));
+            }
+        }
+    }
+
+    static Writer writer;
+    static DateCache dates;
+    tzset();
+    writer = (Writer){ .out = stdout };
+    memset(&dates, 0, sizeof dates);
+    dates.format = query.format == QUERY_TEXT ? "%c" : "%Y-%m-%dT%H:%M:%S%z";
+
+    size_t total_length = 0;
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            total_length += lengths[left_base][right_base];
+
+    if (query.format == QUERY_TEXT && total_length == 0)
+        writer_write_literal(&writer, "No leaderboard data to show.\n");
+    else if (query.format == QUERY_TEXT)
+        writer_write_literal(&writer,
+            "\n-----------------------------------------------------------------\n"
+            "    HEXGAME LEADERBOARD\n"
+            "-----------------------------------------------------------------\n\n");
+    else if (query.format == QUERY_CSV)
+        writer_write_literal(&writer, "round,rank,name,score,reaction_ms,date,seed\n");
+    else
+        writer_write_literal(&writer, "[");
+
+    // Rounds in playing order, total last
+    bool first_row = true;
+    size_t round = 0;
+    for (size_t i = 0; i <= BASE_COMBINATIONS && total_length > 0; ++i) {
+        base_t left_base  = 0;
+        base_t right_base = 0;
+        if (i < BASE_COMBINATIONS) {
+            left_base  = i / (BASE_LENGTH - 1);
+            right_base = i % (BASE_LENGTH - 1);
+            right_base += right_base >= left_base;
+            ++round;
+        }
+        if ( ! query.rounds[left_base][right_base])
+            continue;
+
+        if (query.format == QUERY_TEXT)
+            query_write_round_header(&writer, left_base, right_base, round);
+        for (size_t rank = 1; rank <= lengths[left_base][right_base]; ++rank) {
+            if (query.format == QUERY_JSON && ! first_row)
+                writer_write_literal(&writer, ",\n");
+            else if (query.format == QUERY_JSON)
+                writer_write_literal(&writer, "\n");
+            first_row = false;
+            query_write_row(&writer, &dates, query.format,
+                left_base, right_base, rank, &rows[left_base][right_base][rank - 1]);
+        }
+        if (query.format == QUERY_TEXT)
+            writer_write_literal(&writer,
+                "-----------------------------------------------------------------\n\n");
+    }
+    if (query.format == QUERY_JSON)
+        writer_write_literal(&writer, "\n]\n");
+    writer_flush(&writer);
+
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            free(rows[left_base][right_base]);
+}
+
+static void print_leaderboard(const LeaderBoard* leaderboard)
+{
+    print_leaderboard_query(leaderboard, NULL, (LeaderBoardQuery){
+        .since  = INT64_MIN,
+        .top    = LEADERBOARD_MAX_LENGTH,
+        .format = QUERY_TEXT,
+    });
+}
+
+// --------------------------------
+// Global Leaderboard
+//
+// Merges leaderboard.bin of every user in GLOBAL_HOMES. Files are read by a
+// pool of threads taking turns from a shared counter, and the current slots of
+// each file are kept in global.bin of the invoking user keyed by file mtime,
+// size and inode, so rescans only reread files that changed. Merging sorted
+// top tens of a few hundred users is cheap, so the merged result is computed
+// again every time. The cache never leaves the machine, so it's native byte
+// order.
+
+#if !_WIN32
+
+#define GLOBAL_HOMES       "/home"
+#define GLOBAL_MAX_THREADS 16
+#define GLOBAL_CACHE_MAGIC "HEXGLOB" // 8 bytes with null terminator
+#define GLOBAL_CACHE_VERSION 1
+
+typedef struct global_file
+{
+    char            path[256]; // of leaderboard.bin
+    int64_t         mtime_ns;
+    uint64_t        size;
+    uint64_t        device;
+    uint64_t        inode;
+    LeaderBoardSlot rounds[BASE_LENGTH][BASE_LENGTH]; // current slots, [i][i] unused for i > 0
+} GlobalFile;
+
+typedef struct global_cache_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t file_size; // sizeof(GlobalFile)
+    uint64_t length;
+} GlobalCacheHeader;
+
+typedef struct global_scan
+{
+    GlobalFile* files;
+    size_t*     stale;  // indices of files to read
+    size_t      stale_length;
+    size_t      next;   // of stale, taken atomically
+} GlobalScan;
+
+// Copies current slots of leaderboard.bin at file->path. Writers may be in the
+// middle of a commit, so torn reads are retried. Returns false if the file is
+// not a valid leaderboard.
+static bool global_file_read(GlobalFile* file)
+{
+    LeaderBoardHeader expected;
+    const size_t size = leaderboard_layout(&expected);
+    char* image = malloc(size);
+    gp_assert(image != NULL);
+    int fd = open(file->path, O_RDONLY);
+    bool valid = false;
+    for (size_t attempt = 0; fd != -1 && attempt < 3 && ! valid; ++attempt)
+    {
+        if (pread(fd, image, size, 0) != (ssize_t)size || ! leaderboard_is_valid((LeaderBoardHeader*)image, size))
+            break;
+        valid = true;
+        const LeaderBoard lb = { .header = (LeaderBoardHeader*)image, .size = size, .fd = -1 };
+        for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+            for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+                if (left_base == right_base && left_base != 0)
+                    continue;
+                const LeaderBoardSlot* slots = leaderboard_slots(lb.header, left_base, right_base);
+                valid &= slots[0].sequence == 0 || slots[1].sequence == 0
+                    || leaderboard_slot_is_valid(&slots[0]) || leaderboard_slot_is_valid(&slots[1]);
+                file->rounds[left_base][right_base] = *leaderboard_round(&lb, left_base, right_base);
+            }
+        }
+    }
+    if (fd == -1)
+        fprintf(stderr, "hexgame: cannot open %s: %s\n", file->path, strerror(errno));
+    else {
+        if ( ! valid)
+            fprintf(stderr, "hexgame: %s is not a valid leaderboard file.\n", file->path);
+        gp_assert(close(fd) != -1, strerror(errno));
+    }
+    free(image);
+    return valid;
+}
+
+static int global_scan_thread(void* _scan)
+{
+    GlobalScan* scan = _scan;
+    size_t i;
+    while ((i = __atomic_fetch_add(&scan->next, 1, __ATOMIC_RELAXED)) < scan->stale_length) {
+        GlobalFile* file = &scan->files[scan->stale[i]];
+        if ( ! global_file_read(file))
+            memset(file->rounds, 0, sizeof file->rounds);
+    }
+    return 0;
+}
+
+// Loads cache or returns NULL.
+static GlobalFile* global_cache_load(const char* path, size_t* length)
+{
+    GlobalCacheHeader header;
+    GlobalFile* files = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    if (read(fd, &header, sizeof header) == sizeof header
+        && memcmp(header.magic, GLOBAL_CACHE_MAGIC, sizeof header.magic) == 0
+        && header.version   == GLOBAL_CACHE_VERSION
+        && header.file_size == sizeof(GlobalFile)
+        && header.length    <= SIZE_MAX / sizeof(GlobalFile)
+        && (files = malloc(header.length * sizeof files[0] + 1)) != NULL
+        && read(fd, files, header.length * sizeof files[0]) != (ssize_t)(header.length * sizeof files[0]))
+    {
+        free(files);
+        files = NULL;
+    }
+    gp_assert(close(fd) != -1, strerror(errno));
+    *length = files != NULL ? header.length : 0;
+    return files;
+}
+
+// Replaces cache atomically, so concurrent scans don't see partial caches.
+static void global_cache_store(const char* path, const GlobalFile* files, size_t length)
+{
+    GlobalCacheHeader header = { .version = GLOBAL_CACHE_VERSION, .file_size = sizeof(GlobalFile), .length = length };
+    memcpy(header.magic, GLOBAL_CACHE_MAGIC, sizeof header.magic);
+    char tmp_path[4096 + 32];
+    snprintf(tmp_path, sizeof tmp_path, "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    bool success = fd != -1
+        && write(fd, &header, sizeof header) == sizeof header
+        && write(fd, files, length * sizeof files[0]) == (ssize_t)(length * sizeof files[0]);
+    if (fd != -1)
+        success = close(fd) != -1 && success;
+    success = success && rename(tmp_path, path) != -1;
+    if ( ! success) {
+        fprintf(stderr, "hexgame: could not save %s: %s\n", path, strerror(errno));
+        remove(tmp_path);
+    }
+}
+
+// Cursor of k-way merge, entries of each file are already sorted.
+typedef struct global_cursor
+{
+    const LeaderBoardEntry* entry;
+    const LeaderBoardEntry* end;
+} GlobalCursor;
+
+// Like leaderboard_entry_ranks_before(), but complete ties go to newer entries.
+static bool global_cursor_before(const GlobalCursor* a, const GlobalCursor* b)
+{
+    if (a->entry->score != b->entry->score || a->entry->reaction_ms != b->entry->reaction_ms)
+        return leaderboard_entry_ranks_before(a->entry, b->entry);
+    return (int64_t)le64(a->entry->timestamp) > (int64_t)le64(b->entry->timestamp);
+}
+
+static void global_heap_sift_down(GlobalCursor* heap, size_t length, size_t i)
+{
+    const GlobalCursor cursor = heap[i];
+    for (size_t child; (child = 2*i + 1) < length; i = child) {
+        if (child + 1 < length && global_cursor_before(&heap[child + 1], &heap[child]))
+            ++child;
+        if ( ! global_cursor_before(&heap[child], &cursor))
+            break;
+        heap[i] = heap[child];
+    }
+    heap[i] = cursor;
+}
+
+// Best LEADERBOARD_MAX_LENGTH entries of a round matching name and since of
+// query. Those are filtered from the top tens of each user, not from their
+// whole history.
+static void global_merge(
+    LeaderBoardSlot* merged, const GlobalFile* files, size_t length, base_t left_base, base_t right_base,
+    const LeaderBoardQuery* query)
+{
+    GlobalCursor* heap = malloc(length * sizeof heap[0] + 1);
+    gp_assert(heap != NULL);
+    size_t heap_length = 0;
+    for (size_t i = 0; i < length; ++i) {
+        const LeaderBoardSlot* round = &files[i].rounds[left_base][right_base];
+        if (round->length != 0)
+            heap[heap_length++] = (GlobalCursor){ round->entries, round->entries + le32(round->length) };
+    }
+    for (size_t i = heap_length / 2; i-- > 0;)
+        global_heap_sift_down(heap, heap_length, i);
+
+    size_t merged_length = 0;
+    while (heap_length > 0 && merged_length < LEADERBOARD_MAX_LENGTH)
+    {
+        const LeaderBoardEntry* entry = heap[0].entry;
+        if ((int64_t)le64(entry->timestamp) >= query->since
+            && (query->name == NULL || strncmp(entry->name, query->name, sizeof entry->name) == 0))
+            merged->entries[merged_length++] = *entry;
+        if (++heap[0].entry == heap[0].end)
+            heap[0] = heap[--heap_length];
+        if (heap_length > 0)
+            global_heap_sift_down(heap, heap_length, 0);
+    }
+    merged->length = le32(merged_length);
+    free(heap);
+}
+
+// Builds in-memory leaderboard of everyone's best results. Cache is kept in
+// directory cache_dir if not NULL, own is leaderboard.bin of the invoking user
+// in case their home is not in GLOBAL_HOMES.
+static void leaderboard_global(LeaderBoard* global, const char* cache_dir, const char* own, const LeaderBoardQuery* query)
+{
+    size_t cached_length = 0;
+    char cache_path[4096 + sizeof"/global.bin"];
+    GlobalFile* cached = NULL;
+    if (cache_dir != NULL) {
+        snprintf(cache_path, sizeof cache_path, "%s/global.bin", cache_dir);
+        cached = global_cache_load(cache_path, &cached_length);
+    }
+
+    GlobalFile* files = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    DIR* homes = opendir(GLOBAL_HOMES);
+    if (homes == NULL)
+        fprintf(stderr, "hexgame: cannot open %s: %s\n", GLOBAL_HOMES, strerror(errno));
+    for (struct dirent* home; homes != NULL || own != NULL;)
+    {
+        char path[sizeof files->path];
+        if (homes != NULL && (home = readdir(homes)) != NULL) {
+            if (home->d_name[0] == '.'
+                || snprintf(path, sizeof path, GLOBAL_HOMES "/%s/.hexgame/leaderboard.bin", home->d_name) >= (int)sizeof path)
+                continue;
+        } else if (homes != NULL) {
+            closedir(homes);
+            homes = NULL;
+            continue;
+        } else {
+            if (strlen(own) >= sizeof path)
+                break;
+            strcpy(path, own);
+            own = NULL;
+        }
+
+        struct stat st;
+        if (stat(path, &st) == -1) {
+            if (errno != ENOENT && errno != ENOTDIR)
+                fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+            continue;
+        }
+        bool duplicate = false; // own home is usually in GLOBAL_HOMES too
+        for (size_t i = 0; i < length && ! duplicate; ++i)
+            duplicate = files[i].device == (uint64_t)st.st_dev && files[i].inode == (uint64_t)st.st_ino;
+        if (duplicate)
+            continue;
+        if (length == capacity) {
+            capacity = gp_max(2 * capacity, (size_t)64);
+            files = realloc(files, capacity * sizeof files[0]);
+            gp_assert(files != NULL);
+        }
+        GlobalFile* file = &files[length++];
+        memset(file, 0, sizeof*file);
+        strcpy(file->path, path);
+        file->mtime_ns = (int64_t)st.st_mtime * 1000000000;
+        #if __linux__
+        file->mtime_ns += st.st_mtim.tv_nsec;
+        #endif
+        file->size   = st.st_size;
+        file->device = st.st_dev;
+        file->inode  = st.st_ino;
+    }
+
+    // Cache is in the order of the previous scan, which is usually the same,
+    // so search starts after the previous hit.
+    GlobalScan scan = { .files = files, .stale = malloc(length * sizeof scan.stale[0] + 1) };
+    gp_assert(scan.stale != NULL);
+    for (size_t i = 0, hint = 0; i < length; ++i) {
+        GlobalFile* file = &files[i];
+        const GlobalFile* hit = NULL;
+        for (size_t k = 0; k < cached_length && hit == NULL; ++k) {
+            const GlobalFile* candidate = &cached[(hint + k) % cached_length];
+            if (strcmp(candidate->path, file->path) == 0
+                && candidate->mtime_ns == file->mtime_ns
+                && candidate->size     == file->size
+                && candidate->device   == file->device
+                && candidate->inode    == file->inode)
+            {
+                hit  = candidate;
+                hint = (hint + k + 1) % cached_length;
+            }
+        }
+        if (hit != NULL)
+            *file = *hit;
+        else
+            scan.stale[scan.stale_length++] = i;
+    }
+    free(cached);
+
+    GPThread threads[GLOBAL_MAX_THREADS];
+    size_t threads_length = gp_min(
+        gp_min((size_t)gp_max(1l, sysconf(_SC_NPROCESSORS_ONLN)), (size_t)GLOBAL_MAX_THREADS), scan.stale_length);
+    for (size_t i = 1; i < threads_length; ++i)
+        gp_assert(gp_thread_create(&threads[i], global_scan_thread, &scan) == 0);
+    global_scan_thread(&scan);
+    for (size_t i = 1; i < threads_length; ++i)
+        gp_thread_join(threads[i], NULL);
+    if (cache_dir != NULL && scan.stale_length > 0)
+        global_cache_store(cache_path, files, length);
+
+    *global = (LeaderBoard){ .fd = -1, .history_fd = -1, .stats_fd = -1, .schedule_fd = -1 };
+    global->header = (LeaderBoardHeader*)leaderboard_new_image(&global->size);
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+            if (left_base != right_base || left_base == 0)
+                global_merge(leaderboard_slots(global->header, left_base, right_base),
+                    files, length, left_base, right_base, query);
+    leaderboard_image_seal((char*)global->header);
+    free(scan.stale);
+    free(files);
+}
+
+#endif // !_WIN32
+
+// --------------------------------
+// Headless Replay
+//
+// Plays sessions from a recorded answer stream on a virtual clock:
+//
+//     session 1729     # starts a round of session with seed 1729
+//     weights 1 2 ...  # of 16 questions, adaptive rounds only
+//     0.812 1010       # seconds since previous answer and the answer
+//
+// Older recordings start rounds with "seed 1729", which seeds the round alone
+// with gp_random_state().
+// A round ends when its virtual time runs out or when the next round starts.
+// Answers that did not fit in time are skipped.
+
+// Lines are cut in place from one big buffer filled with fread(), so replaying
+// doesn't go through stdio for every line.
+typedef struct replay
+{
+    FILE*  in;
+    char*  line;     // in buffer, NUL-terminated without newline and comment
+    bool   has_line; // read ahead but not consumed
+    bool   eof;
+    size_t line_number;
+    size_t start;    // of unread bytes in buffer
+    size_t length;   // of buffered bytes
+    char   buffer[1 << 16];
+} Replay;
+
+// Returns false on end of stream. Lines longer than buffer are split.
+static bool replay_peek(Replay* replay)
+{
+    while ( ! replay->has_line)
+    {
+        char* begin   = replay->buffer + replay->start;
+        char* newline = memchr(begin, '\n', replay->length - replay->start);
+        if (newline == NULL && ! replay->eof && (replay->start > 0 || replay->length < sizeof replay->buffer - 1)) {
+            memmove(replay->buffer, begin, replay->length - replay->start);
+            replay->length -= replay->start;
+            replay->start   = 0;
+            const size_t bytes_read = fread(
+                replay->buffer + replay->length, 1, sizeof replay->buffer - 1 - replay->length, replay->in);
+            replay->length += bytes_read;
+            replay->eof     = bytes_read == 0;
+            continue;
+        }
+        if (newline == NULL && replay->start == replay->length)
+            return false;
+        if (newline == NULL)
+            newline = replay->buffer + replay->length; // last line, buffer has room for NUL
+        *newline = '\0';
+        replay->start = newline - replay->buffer + (newline != replay->buffer + replay->length);
+        ++replay->line_number;
+
+        char* comment = memchr(begin, '#', newline - begin);
+        if (comment != NULL)
+            *comment = '\0';
+        while (isspace((unsigned char)*begin))
+            ++begin;
+        replay->line     = begin;
+        replay->has_line = *begin != '\0';
+    }
+    return true;
+}
+
+// Rounds start with seed, bits are only given if not 4. Session is false for
+// rounds seeded alone.
+static bool replay_peek_seed(Replay* replay, uint64_t* seed, unsigned* bits, bool* session)
+{
+    unsigned long long _seed;
+    unsigned _bits = 4;
+    if ( ! replay_peek(replay) || replay->line[0] != 's') // answers are way more common
+        return false;
+    if (sscanf(replay->line, " session %llu bits %u", &_seed, &_bits) >= 1)
+        *session = true;
+    else if (sscanf(replay->line, " seed %llu bits %u", &_seed, &_bits) >= 1)
+        *session = false;
+    else
+        return false;
+    if (*session && (_seed == 0 || _seed > UINT32_MAX)) {
+        fprintf(stderr, "hexgame: replay line %zu: invalid session seed %llu\n", replay->line_number, _seed);
+        _seed = 1;
+    }
+    if (_bits != 4 && _bits != 8 && _bits != 16 && _bits != 32) {
+        fprintf(stderr, "hexgame: replay line %zu: invalid bits %u\n", replay->line_number, _bits);
+        _bits = 4;
+    }
+    *seed = _seed;
+    *bits = _bits;
+    return true;
+}
+
+static bool replay_peek_weights(Replay* replay, float weights[16])
+{
+    int offset = 0;
+    if ( ! replay_peek(replay) || replay->line[0] != 'w'
+        || sscanf(replay->line, " weights%n", &offset) != 0 || offset == 0)
+        return false;
+    const char* c = replay->line + offset;
+    for (size_t i = 0; i < 16; ++i) {
+        char* end;
+        weights[i] = strtof(c, &end);
+        if (end == c || ! (weights[i] > 0.f))
+            return false;
+        c = end;
+    }
+    return true;
+}
+
+// Non-negative seconds like 0.812 at str. Up to 9 decimals are exact nanoseconds,
+// so dividing them once gives the same double as strtod() without its locale
+// and generality, which is the slow part of replaying. Anything else goes to
+// strtod(). Returns end of seconds or NULL if there were none.
+static const char* replay_parse_seconds(const char* str, double* seconds)
+{
+    uint64_t nanoseconds = 0;
+    size_t   whole    = 0;
+    size_t   decimals = 0;
+    const char* c = str;
+    for (; (unsigned)(*c - '0') < 10 && whole < 6; ++c, ++whole) // below 2^53 ns
+        nanoseconds = nanoseconds * 10 + (*c - '0');
+    if (*c == '.')
+        for (++c; (unsigned)(*c - '0') < 10 && decimals < 9; ++c, ++decimals)
+            nanoseconds = nanoseconds * 10 + (*c - '0');
+    if (whole + decimals > 0 && (*c == '\0' || isspace((unsigned char)*c))) {
+        for (; decimals < 9; ++decimals)
+            nanoseconds *= 10;
+        *seconds = nanoseconds / 1e9;
+        return c;
+    }
+    char* end;
+    *seconds = strtod(str, &end);
+    return end != str && *seconds >= 0. ? end : NULL;
+}
+
+// Returns false if there are no more rounds. Only 4 bit rounds are counted to
+// stats. Session seed is 0 for rounds seeded alone.
+static bool replay_round(
+    Replay*   replay,
+    base_t    left_base,
+    base_t    right_base,
+    Stats*    stats,
+    unsigned* bits,
+    uint32_t* session_seed,
+    size_t*   score,
+    uint16_t* reaction_ms)
+{
+    uint64_t seed;
+    bool     session;
+    while ( ! replay_peek_seed(replay, &seed, bits, &session))
+        if ( ! replay_peek(replay))
+            return false;
+        else
+            replay->has_line = false;
+    replay->has_line = false;
+    *session_seed = session ? seed : 0;
+
+    float weights[16];
+    const bool adaptive = replay_peek_weights(replay, weights);
+    if (adaptive)
+        replay->has_line = false;
+    QuestionTable questions;
+    GameRound round = game_round_new(left_base, right_base, *bits,
+        session ? session_round_random_state(seed, left_base, right_base) : gp_random_state(seed),
+        &questions, adaptive ? weights : NULL);
+    double clock = 0.;
+    while (clock < ROUND_DURATION)
+    {
+        const uint32_t question = game_round_next_question(&round);
+        const double   asked_at = clock;
+        size_t points = 0;
+        do {
+            unsigned next_bits;
+            bool     next_session;
+            if ( ! replay_peek(replay) || replay_peek_seed(replay, &seed, &next_bits, &next_session))
+                goto out_of_answers;
+            replay->has_line = false;
+
+            double delay;
+            const char* answer = replay_parse_seconds(replay->line, &delay);
+            if (answer == NULL) {
+                fprintf(stderr, "hexgame: replay line %zu: expected seconds like 0.812, got '%s'\n",
+                    replay->line_number, replay->line);
+                continue;
+            }
+            while (isspace((unsigned char)*answer))
+                ++answer;
+            size_t answer_length = 0;
+            while (answer[answer_length] != '\0' && ! isspace((unsigned char)answer[answer_length]))
+                ++answer_length;
+            if (answer_length == 0) {
+                fprintf(stderr, "hexgame: replay line %zu: expected answer after seconds\n", replay->line_number);
+                continue;
+            }
+            if ((clock += delay) >= ROUND_DURATION)
+                goto out_of_answers;
+            points = game_round_submit(&round, parse_answer(answer, answer_length, right_base), clock - asked_at);
+            if (*bits == 4)
+                stats_record(stats, left_base, right_base, question, points != 0, clock - asked_at);
+        } while (points == 0);
+    }
+    out_of_answers:
+    *score       = round.score;
+    *reaction_ms = game_round_reaction_ms(&round);
+    return true;
+}
+
+// Returns false if there was no complete session left. Bits of the last round
+// are stored to bits. Seed is the session seed of all rounds, 0 if some round
+// was seeded alone or rounds came from different sessions.
+static bool replay_session(
+    Replay*   replay,
+    Stats*    stats,
+    unsigned* bits,
+    uint32_t* seed,
+    score_t   scores[BASE_LENGTH][BASE_LENGTH],
+    uint16_t  reactions_ms[BASE_LENGTH][BASE_LENGTH])
+{
+    memset(scores,       0, BASE_LENGTH * sizeof scores[0]);
+    memset(reactions_ms, 0, BASE_LENGTH * sizeof reactions_ms[0]);
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            size_t score;
+            uint32_t round_seed;
+            if (left_base == right_base)
+                continue;
+            if ( ! replay_round(
+                replay, left_base, right_base, stats, bits, &round_seed, &score, &reactions_ms[left_base][right_base]))
+                return false;
+            scores[0][0] += scores[left_base][right_base] = score;
+            if (round_index(left_base, right_base) == 0)
+                *seed = round_seed;
+            else if (round_seed != *seed)
+                *seed = 0;
+        }
+    }
+    return true;
+}
+
+// Prints scores of each session in round order with total last. If name is not
+// NULL, results are also submitted to leaderboard.
+static void replay(LeaderBoard* leaderboard, FILE* in, const char* name)
+{
+    Replay replay = { .in = in };
+    score_t  scores[BASE_LENGTH][BASE_LENGTH];
+    uint16_t reactions_ms[BASE_LENGTH][BASE_LENGTH];
+    static Stats stats; // of all sessions
+    unsigned bits;
+    uint32_t seed;
+    size_t sessions = 0;
+
+    Timer replay_timer = timer_new(0.);
+    while (replay_session(&replay, &stats, &bits, &seed, scores, reactions_ms))
+    {
+        ++sessions;
+        printf("%zu:", sessions);
+        for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+            for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+                if (left_base != right_base)
+                    printf(" %u", (unsigned)scores[left_base][right_base]);
+        printf(" %u\n", (unsigned)scores[0][0]);
+
+        if (name != NULL) {
+            HighScorePosition new_high_scores[BASE_COMBINATIONS + 1];
+            leaderboard_submit(leaderboard, bits, seed, scores, reactions_ms, name, time(NULL), new_high_scores);
+        }
+    }
+    if (name != NULL)
+        leaderboard_add_stats(leaderboard, &stats);
+    double elapsed = timer_elapsed(&replay_timer);
+    fprintf(stderr, "hexgame: replayed %zu sessions (%zu rounds) in %g seconds\n",
+        sessions, sessions * BASE_COMBINATIONS, elapsed);
+}
+
+#define VERIFY_ANSWER_DELAY "0.050000000" // seconds as recorded
+
+// Derives questions of a session from its seed like game() does without
+// adaptive weights, which is how seeded tournament sessions are played. If in
+// is NULL, prints first questions of each round, or with answers, a recording
+// that answers them for replay. Every fourth question is answered wrong first
+// and answers are VERIFY_ANSWER_DELAY apart, so rounds end when they run out
+// of questions or time. Otherwise replays in, which must be recordings of
+// sessions with seed, and prints their scores like replay(). Returns false if
+// in had other sessions or none.
+static bool verify(uint32_t seed, unsigned bits, size_t questions, bool answers, FILE* in /*nullable*/)
+{
+    if (in != NULL) {
+        Replay replay = { .in = in };
+        score_t  scores[BASE_LENGTH][BASE_LENGTH];
+        uint16_t reactions_ms[BASE_LENGTH][BASE_LENGTH];
+        static Stats stats;
+        unsigned session_bits;
+        uint32_t session_seed;
+        size_t sessions = 0;
+        while (replay_session(&replay, &stats, &session_bits, &session_seed, scores, reactions_ms))
+        {
+            ++sessions;
+            if (session_seed != seed) {
+                fprintf(stderr, "hexgame: session %zu was not played with seed %lu\n", sessions, (unsigned long)seed);
+                return false;
+            }
+            printf("%zu:", sessions);
+            for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
+                for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
+                    if (left_base != right_base)
+                        printf(" %u", (unsigned)scores[left_base][right_base]);
+            printf(" %u\n", (unsigned)scores[0][0]);
+        }
+        if (sessions == 0)
+            fprintf(stderr, "hexgame: no complete sessions to verify\n");
+        return sessions != 0;
+    }
+
+    Writer writer = { .out = stdout };
+    Timer timer = timer_new(0.);
+    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base) {
+        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base) {
+            if (left_base == right_base)
+                continue;
+            GameRound round = game_round_new(
+                left_base, right_base, bits, session_round_random_state(seed, left_base, right_base), NULL, NULL);
+            Line line = {0};
+            if (answers) {
+                line_append_literal(&line, "session ");
+                line_append_number(&line, seed);
+                if (bits != 4) {
+                    line_append_literal(&line, " bits ");
+                    line_append_number(&line, bits);
+                }
+                line_append_literal(&line, "\n");
+                writer_write(&writer, line.buffer, line.length);
+            }
+            for (size_t i = 0; answers && i < questions; ++i) {
+                const uint32_t question = game_round_next_question(&round);
+                char digits[NUMBER_BUFFER_SIZE];
+                for (uint32_t answer = question ^ (i % 4 == 3); ; answer = question) {
+                    line.length = 0;
+                    line_append_literal(&line, VERIFY_ANSWER_DELAY " ");
+                    line_append(&line, digits, format_number(digits, answer, right_base, bits));
+                    line_append_literal(&line, "\n");
+                    writer_write(&writer, line.buffer, line.length);
+                    if (answer == question)
+                        break;
+                }
+            }
+            if (answers)
+                continue;
+            line_append(&line, round_names[left_base][right_base], strlen(round_names[left_base][right_base]));
+            line_append_literal(&line, ":");
+            for (size_t i = 0; i < questions; ++i) {
+                char digits[NUMBER_BUFFER_SIZE];
+                if (line.length + 1 + NUMBER_BUFFER_SIZE + 1 > sizeof line.buffer) {
+                    writer_write(&writer, line.buffer, line.length);
+                    line.length = 0;
+                }
+                line_append_literal(&line, " ");
+                line_append(&line, digits, format_number(digits, game_round_next_question(&round), left_base, bits));
+            }
+            line_append_literal(&line, "\n");
+            writer_write(&writer, line.buffer, line.length);
+        }
+    }
+    writer_flush(&writer);
+    fprintf(stderr, "hexgame: derived %zu questions in %g seconds\n",
+        questions * BASE_COMBINATIONS, timer_elapsed(&timer));
+    return true;
+}
+
+// --------------------------------
+// Event Log Analysis
+//
+// Event logs are mapped to memory and indexed by block in one pass, which only
+// touches block headers. Blocks are then split evenly to threads, which decode
+// them to their own stats and players to be merged at the end. Bad magic ends
+// a file, since that's what a torn last write looks like.
+
+#define ANALYZE_MAX_THREADS 64
+
+typedef struct analysis_player
+{
+    char     name[16]; // not null-terminated if 16 bytes
+    uint64_t sessions;
+    uint64_t rounds;
+    uint64_t questions;
+    uint64_t correct;
+    uint64_t wrong;
+    uint64_t keystrokes;
+    uint64_t reaction_us; // sum of correct answers
+    uint64_t best_total;
+} AnalysisPlayer;
+
+typedef struct analysis_block
+{
+    const uint8_t* data; // after length
+    size_t         size;
+} AnalysisBlock;
+
+typedef struct analysis
+{
+    GPThread             thread;
+    const AnalysisBlock* blocks;
+    size_t               blocks_length;
+    Stats                stats; // of 4 bit rounds
+    AnalysisPlayer*      players;
+    size_t               players_length;
+    size_t               players_capacity;
+    GPHashMap*           player_indices; // by name
+    size_t               events;
+    size_t               corrupt_blocks;
+} Analysis;
+
+static AnalysisPlayer* analysis_player(Analysis* analysis, const char name[16])
+{
+    const size_t* index = gp_hash_map_get(analysis->player_indices, name, 16);
+    if (index != NULL)
+        return &analysis->players[*index];
+    if (analysis->players_length == analysis->players_capacity) {
+        analysis->players_capacity = gp_max(2 * analysis->players_capacity, (size_t)16);
+        analysis->players = realloc(analysis->players, analysis->players_capacity * sizeof analysis->players[0]);
+        gp_assert(analysis->players != NULL);
+    }
+    gp_hash_map_put(analysis->player_indices, name, 16, &analysis->players_length);
+    AnalysisPlayer* player = &analysis->players[analysis->players_length++];
+    *player = (AnalysisPlayer){0};
+    memcpy(player->name, name, 16);
+    return player;
+}
+
+// Returns false if block is malformed, events before that are still counted.
+static bool analysis_add_block(Analysis* analysis, const AnalysisBlock* block)
+{
+    const uint8_t* p   = block->data;
+    const uint8_t* end = p + block->size;
+    uint64_t seed, timestamp, name_length;
+    if ( ! varint_decode(&p, end, &seed) || ! varint_decode(&p, end, &timestamp)
+        || ! varint_decode(&p, end, &name_length) || name_length > 16 || (size_t)(end - p) < name_length + 3)
+        return false;
+    char name[16] = "";
+    memcpy(name, p, name_length);
+    p += name_length;
+    const base_t   left_base  = p[0];
+    const base_t   right_base = p[1];
+    const unsigned bits       = p[2];
+    p += 3;
+    if (left_base >= BASE_LENGTH || right_base >= BASE_LENGTH)
+        return false;
+    const bool counted = bits == 4 && left_base != right_base;
+    AnalysisPlayer* player = analysis_player(analysis, name);
+
+    uint64_t us = 0;
+    uint64_t asked_us = 0;
+    uint64_t question = 0;
+    bool has_question = false;
+    while (p < end)
+    {
+        uint64_t tag, value;
+        if ( ! varint_decode(&p, end, &tag))
+            return false;
+        us += tag >> 3;
+        ++analysis->events;
+        if ((tag & 7) == EVENT_KEY) {
+            if (p++ == end)
+                return false;
+            ++player->keystrokes;
+            continue;
+        }
+        if ( ! varint_decode(&p, end, &value))
+            return false;
+        switch (tag & 7)
+        {
+        case EVENT_QUESTION:
+            question     = value;
+            asked_us     = us;
+            has_question = true;
+            ++player->questions;
+            break;
+
+        case EVENT_CORRECT:
+            ++player->correct;
+            player->reaction_us += us - asked_us;
+            if (counted && has_question)
+                stats_record(&analysis->stats, left_base, right_base, question, true, (us - asked_us) / 1e6);
+            break;
+
+        case EVENT_WRONG:
+            ++player->wrong;
+            if (counted && has_question)
+                stats_record(&analysis->stats, left_base, right_base, question, false, 0.);
+            break;
+
+        case EVENT_ROUND:
+            ++player->rounds;
+            break;
+
+        case EVENT_SESSION: // leaderboard name is not needed
+            if ( ! varint_decode(&p, end, &name_length) || (size_t)(end - p) < name_length)
+                return false;
+            p += name_length;
+            ++player->sessions;
+            player->best_total = gp_max(player->best_total, value);
+            break;
+
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+static int analysis_thread(void* _analysis)
+{
+    Analysis* analysis = _analysis;
+    for (size_t i = 0; i < analysis->blocks_length; ++i)
+        if ( ! analysis_add_block(analysis, &analysis->blocks[i]))
+            ++analysis->corrupt_blocks;
+    return 0;
+}
+
+// Appends blocks of an event log to blocks, which grows as needed.
+static void analysis_index(
+    const char* path, const uint8_t* data, size_t size, AnalysisBlock** blocks, size_t* length, size_t* capacity)
+{
+    const uint8_t* p   = data;
+    const uint8_t* end = data + size;
+    while (p < end)
+    {
+        uint64_t block_size;
+        const uint8_t* start = p + sizeof EVENT_LOG_MAGIC - 1;
+        if ((size_t)(end - p) < sizeof EVENT_LOG_MAGIC - 1 || memcmp(p, EVENT_LOG_MAGIC, start - p) != 0
+            || ! varint_decode(&start, end, &block_size) || block_size > (size_t)(end - start))
+        {
+            fprintf(stderr, "hexgame: %s: truncated or corrupt event block at offset %zu, ignoring rest.\n", path, (size_t)(p - data));
+            return;
+        }
+        if (*length == *capacity) {
+            *capacity = gp_max(2 * *capacity, (size_t)1024);
+            *blocks   = realloc(*blocks, *capacity * sizeof**blocks);
+            gp_assert(*blocks != NULL);
+        }
+        (*blocks)[(*length)++] = (AnalysisBlock){ .data = start, .size = block_size };
+        p = start + block_size;
+    }
+}
+
+static int analysis_player_compare(const void* a, const void* b)
+{
+    return strncmp(((const AnalysisPlayer*)a)->name, ((const AnalysisPlayer*)b)->name, 16);
+}
+
+// Prints stats of every player and every question of 4 bit rounds in event
+// logs at paths. Returns false if some file could not be read.
+static bool analyze(const char* const* paths, size_t paths_length, size_t threads)
+{
+    static Analysis analyses[ANALYZE_MAX_THREADS];
+    const uint8_t** images = calloc(paths_length, sizeof images[0]);
+    size_t*         sizes  = calloc(paths_length, sizeof sizes[0]);
+    gp_assert(images != NULL && sizes != NULL);
+    AnalysisBlock* blocks = NULL;
+    size_t blocks_length = 0;
+    size_t blocks_capacity = 0;
+    size_t bytes = 0;
+    bool success = true;
+
+    Timer timer = timer_new(0.);
+    for (size_t i = 0; i < paths_length; ++i)
+    {
+        int fd = open(paths[i], O_RDONLY);
+        struct stat st;
+        if (fd == -1 || fstat(fd, &st) == -1) {
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", paths[i], strerror(errno));
+            if (fd != -1)
+                close(fd);
+            success = false;
+            continue;
+        }
+        sizes[i] = st.st_size;
+        if (sizes[i] > 0) {
+            #if _WIN32
+            void* image = malloc(sizes[i]);
+            if (image != NULL && read(fd, image, sizes[i]) != (ssize_t)sizes[i]) {
+                free(image);
+                image = NULL;
+            }
+            #else
+            void* image = mmap(NULL, sizes[i], PROT_READ, MAP_PRIVATE, fd, 0);
+            if (image == MAP_FAILED)
+                image = NULL;
+            #endif
+            if (image == NULL) {
+                fprintf(stderr, "hexgame: could not read %s: %s\n", paths[i], strerror(errno));
+                sizes[i] = 0;
+                success = false;
+            }
+            images[i] = image;
+        }
+        gp_assert(close(fd) != -1, strerror(errno));
+        analysis_index(paths[i], images[i], sizes[i], &blocks, &blocks_length, &blocks_capacity);
+        bytes += sizes[i];
+    }
+
+    threads = gp_max((size_t)1, gp_min(threads, (size_t)ANALYZE_MAX_THREADS));
+    threads = gp_min(threads, gp_max(blocks_length, (size_t)1));
+    for (size_t i = 0; i < threads; ++i)
+    {
+        const size_t start = blocks_length * i / threads;
+        analyses[i].blocks         = blocks + start;
+        analyses[i].blocks_length  = blocks_length * (i + 1) / threads - start;
+        analyses[i].player_indices = gp_hash_map_new(gp_heap, &(GPMapInitializer){ .element_size = sizeof(size_t) });
+        if (i > 0)
+            gp_assert(gp_thread_create(&analyses[i].thread, analysis_thread, &analyses[i]) == 0);
+    }
+    analysis_thread(&analyses[0]);
+
+    Analysis* total = &analyses[0];
+    for (size_t i = 1; i < threads; ++i)
+    {
+        Analysis* analysis = &analyses[i];
+        gp_thread_join(analysis->thread, NULL);
+        stats_add(&total->stats, &analysis->stats);
+        total->events         += analysis->events;
+        total->corrupt_blocks += analysis->corrupt_blocks;
+        for (size_t j = 0; j < analysis->players_length; ++j) {
+            const AnalysisPlayer* other  = &analysis->players[j];
+            AnalysisPlayer*       player = analysis_player(total, other->name);
+            player->sessions    += other->sessions;
+            player->rounds      += other->rounds;
+            player->questions   += other->questions;
+            player->correct     += other->correct;
+            player->wrong       += other->wrong;
+            player->keystrokes  += other->keystrokes;
+            player->reaction_us += other->reaction_us;
+            player->best_total   = gp_max(player->best_total, other->best_total);
+        }
+        free(analysis->players);
+        gp_hash_map_delete(analysis->player_indices);
+    }
+    const double elapsed = timer_elapsed(&timer);
+
+    puts("\n-----------------------------------------------------------------");
+    puts("    HEXGAME ANALYSIS");
+    puts("-----------------------------------------------------------------\n");
+    printf("%-16s | %8s | %8s | %8s | %8s | %8s | %s\n",
+        "Player", "Sessions", "Rounds", "Answers", "Accuracy", "Mean", "Best");
+    puts("-----------------------------------------------------------------");
+    if (total->players_length > 0)
+        qsort(total->players, total->players_length, sizeof total->players[0], analysis_player_compare);
+    for (size_t i = 0; i < total->players_length; ++i)
+    {
+        const AnalysisPlayer* player  = &total->players[i];
+        const uint64_t        answers = player->correct + player->wrong;
+        printf("%-16.16s | %8llu | %8llu | %8llu | ", player->name,
+            (unsigned long long)player->sessions, (unsigned long long)player->rounds, (unsigned long long)answers);
+        if (answers == 0)
+            printf("%8s | ", "-");
+        else
+            printf("%6.0f %% | ", 100. * player->correct / answers);
+        if (player->correct == 0)
+            printf("%8s | ", "-");
+        else
+            printf("%6.2f s | ", player->reaction_us / 1e6 / player->correct);
+        if (player->sessions == 0)
+            puts("-");
+        else
+            printf("%llu\n", (unsigned long long)player->best_total);
+    }
+    puts("-----------------------------------------------------------------");
+    print_stats(&total->stats);
+
+    fprintf(stderr, "hexgame: analyzed %zu events in %zu blocks, %.1f MB in %g seconds with %zu threads\n",
+        total->events, blocks_length, bytes / 1e6, elapsed, threads);
+    if (total->corrupt_blocks > 0)
+        fprintf(stderr, "hexgame: skipped rest of %zu malformed blocks\n", total->corrupt_blocks);
+
+    free(total->players);
+    gp_hash_map_delete(total->player_indices);
+    free(blocks);
+    for (size_t i = 0; i < paths_length; ++i) {
+        if (images[i] == NULL)
+            continue;
+        #if _WIN32
+        free((void*)images[i]);
+        #else
+        gp_assert(munmap((void*)images[i], sizes[i]) != -1, strerror(errno));
+        #endif
+    }
+    free(images);
+    free(sizes);
+    return success;
+}
+
+// --------------------------------
+// Server
+//
+// Hosts sessions over a Unix domain socket. Each worker thread runs its own
+// epoll event loop and accepts connections from the shared listening socket,
+// so a session is only ever touched by the worker that accepted it and needs
+// no locking. Sessions are small state machines driven by socket input and
+// deadlines. Deadlines of a worker are kept in a binary heap with a single
+// timerfd armed to the earliest one, which keeps idle sessions at one file
+// descriptor each. The protocol is the terminal game as plain text lines.
+//
+// Finished sessions are queued to a single submit thread, which is the only
+// one touching the leaderboard, so syncing it to disk never stalls the event
+// loops. Queues are pipes of pointers, which are written atomically, and
+// results come back through a pipe of each worker polled with its sessions.
+
+#if __linux__
+
+#define SERVER_MAX_WORKERS   4
+#define SERVER_COUNTDOWN     5. // seconds
+
+typedef enum session_state
+{
+    SESSION_COUNTDOWN,
+    SESSION_ROUND,
+    SESSION_NAME,
+    SESSION_SUBMITTING, // waiting for submit thread, not polled for input
+    SESSION_CLOSED,
+} SessionState;
+
+typedef struct session
+{
+    int             fd;
+    uint8_t         state;
+    uint8_t         round; // index to server_rounds
+    uint8_t         input_length;
+    bool            truncating;
+    uint32_t        heap_index; // SESSION_NOT_IN_HEAP if no deadline pending
+    uint32_t        seed;
+    GameRound       game;
+    QuestionTable   questions; // of game
+    Timer           timer; // countdown or round
+    clock_ns_t      asked_at;
+    score_t         scores[BASE_LENGTH][BASE_LENGTH];
+    uint16_t        reactions_ms[BASE_LENGTH][BASE_LENGTH];
+    struct session* next_closed;
+    char            input[64];
+} Session;
 
-#define LEADERBOARD_MAX_LENGTH 10
+#define SESSION_NOT_IN_HEAP UINT32_MAX
 
-static const char* base_lowercase[BASE_LENGTH] = {
-    [BASE2]  = "binary",
-    [BASE10] = "decimal",
-    [BASE16] = "hexadecimal"
-};
+static_assert(sizeof(Session) < 1024, "Sessions should stay small to host many.");
 
-static const char* base_titlecase[BASE_LENGTH] = {
-    [BASE2]  = "Binary",
-    [BASE10] = "Decimal",
-    [BASE16] = "Hexadecimal"
-};
+typedef struct server_worker
+{
+    struct server* server;
+    int            epoll_fd;
+    int            timer_fd;
+    int            submitted_fds[2]; // pipe of ServerSubmission pointers from submit thread
+    clock_ns_t     armed; // deadline of timer_fd
+    Session**      heap;  // min-heap by timer.deadline
+    size_t         heap_length;
+    size_t         heap_capacity;
+    Session*       closed; // freed after handling all events of epoll_wait()
+    Stats*         stats;  // not yet submitted to stats.bin, one of stats_buffers
+    Stats*         stats_spare; // the other one, NULL while with submit thread
+    bool           stats_deferred; // submit stats when spare comes back
+    Stats          stats_buffers[2];
+    GPThread       thread;
+} ServerWorker;
+
+typedef struct server
+{
+    LeaderBoard*  leaderboard; // only used by submit thread
+    int           listen_fd;
+    int           submit_fds[2]; // pipe of ServerSubmission pointers to submit thread
+    GPThread      submit_thread;
+    size_t        workers_length;
+    ServerWorker  workers[SERVER_MAX_WORKERS];
+} Server;
 
-#define TIME_RESET true
-#define TIME_NOW   false
+// Results of a session copied out of it, so the submit thread never touches
+// sessions. Allocated by worker, filled in by submit thread and freed by worker.
+typedef struct server_submission
+{
+    Session*      session; // NULL if only stats are submitted
+    ServerWorker* worker;
+    uint32_t      seed;
+    time_t        timestamp;
+    char          name[sizeof((LeaderBoardEntry*)0)->name + sizeof""];
+    score_t       scores[BASE_LENGTH][BASE_LENGTH];
+    uint16_t      reactions_ms[BASE_LENGTH][BASE_LENGTH];
+    Stats*        stats; // of worker since its previous submission, NULL if none
+    size_t        new_high_scores_length; // result
+} ServerSubmission;
 
-#define SCORE_FIELD_WIDTH 8
+// epoll_event.data.u64 of anything else than sessions.
+#define SERVER_EVENT_TIMER     0
+#define SERVER_EVENT_LISTEN    1
+#define SERVER_EVENT_SUBMITTED 2
 
-#define BASE_COMBINATIONS (BASE_LENGTH * (BASE_LENGTH - 1)) // distinct
+static const struct { base_t left_base, right_base; } server_rounds[BASE_COMBINATIONS] = {
+    {BASE2,  BASE10}, {BASE2,  BASE16},
+    {BASE10, BASE2 }, {BASE10, BASE16},
+    {BASE16, BASE2 }, {BASE16, BASE10},
+};
+
+// --------------------------------
+// Deadline Heap
 
-static double game_time(bool reset)
+static bool deadline_before(const Session* a, const Session* b)
 {
-    static __uint128_t start;
-    struct timespec t_now;
-    if (reset) {
-        struct timespec t_start;
-        gp_assert(timespec_get(&t_start, TIME_UTC));
-        start = (__uint128_t)(t_start.tv_sec)*1000000000 + t_start.tv_nsec;
-        return 0.;
-    }
-    gp_assert(timespec_get(&t_now, TIME_UTC));
-    __uint128_t now = (__uint128_t)(t_now.tv_sec)*1000000000 + t_now.tv_nsec;
+    return (int64_t)(a->timer.deadline - b->timer.deadline) < 0;
+}
 
-    double diff = now - start;
-    return diff/1000000000;
+static void deadline_heap_set(ServerWorker* worker, size_t i, Session* session)
+{
+    worker->heap[i] = session;
+    session->heap_index = i;
 }
 
-static const char* u4toa_binary(size_t u)
+static void deadline_heap_sift(ServerWorker* worker, size_t i)
 {
-    gp_assert(u <= 0xF, "Argument should be of size uint4_t.");
+    Session* session = worker->heap[i];
+    while (i > 0 && deadline_before(session, worker->heap[(i - 1)/2])) {
+        deadline_heap_set(worker, i, worker->heap[(i - 1)/2]);
+        i = (i - 1)/2;
+    }
+    while (2*i + 1 < worker->heap_length) {
+        size_t child = 2*i + 1;
+        if (child + 1 < worker->heap_length && deadline_before(worker->heap[child + 1], worker->heap[child]))
+            ++child;
+        if ( ! deadline_before(worker->heap[child], session))
+            break;
+        deadline_heap_set(worker, i, worker->heap[child]);
+        i = child;
+    }
+    deadline_heap_set(worker, i, session);
+}
 
-    char* buf = gp_mem_alloc(&gp_last_scope()->base, 8);
-    memset(buf, 0, 8);
+// Arms timer_fd to the earliest deadline, or disarms if none.
+static void deadline_heap_arm(ServerWorker* worker)
+{
+    struct itimerspec spec = {0};
+    worker->armed = worker->heap_length > 0 ? worker->heap[0]->timer.deadline : 0;
+    if (worker->heap_length > 0)
+        spec.it_value = clock_timespec(worker->armed);
+    gp_assert(timerfd_settime(worker->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) != -1, strerror(errno));
+}
 
-    for (size_t i = 4-1; i != (size_t)-1; --i) {
-        buf[i] = (u & 1) + '0';
-        u >>= 1;
+static void deadline_heap_remove(ServerWorker* worker, Session* session)
+{
+    if (session->heap_index == SESSION_NOT_IN_HEAP)
+        return;
+    size_t i = session->heap_index;
+    session->heap_index = SESSION_NOT_IN_HEAP;
+    Session* last = worker->heap[--worker->heap_length];
+    if (last != session) {
+        deadline_heap_set(worker, i, last);
+        deadline_heap_sift(worker, i);
     }
-    gp_assert(strlen(buf) == 4);
-    return buf;
 }
 
-static size_t atou4_binary(const char* str)
+static void deadline_heap_push(ServerWorker* worker, Session* session)
 {
-    while (isspace(*str))
-        ++str;
-    size_t result = 0;
-    size_t length = 0;
-    while ('0' <= *str && *str <= '1') {
-        result = (result << 1) | (*str - '0');
-        ++str;
-        ++length;
+    deadline_heap_remove(worker, session);
+    if (worker->heap_length == worker->heap_capacity) {
+        worker->heap_capacity = gp_max(2*worker->heap_capacity, (size_t)64);
+        worker->heap = realloc(worker->heap, worker->heap_capacity * sizeof worker->heap[0]);
+        gp_assert(worker->heap != NULL);
     }
-    if (length == 0 || length > 4)
-        return -1; // will be interpreted as wrong answer
-    return result;
+    deadline_heap_set(worker, worker->heap_length++, session);
+    deadline_heap_sift(worker, session->heap_index);
+    if (worker->heap[0] == session)
+        deadline_heap_arm(worker);
 }
 
-__attribute__((format(scanf, 1, 2)))
-static int read_input(const char* format, ...)
+// --------------------------------
+// Sessions
+
+// Responses are short and socket buffers large, so a client that does not keep
+// up with reading is disconnected instead of buffering output for it.
+static void session_send(Session* session, const char* format, ...)
 {
+    char message[256];
     va_list args;
     va_start(args, format);
+    int length = vsnprintf(message, sizeof message, format, args);
+    va_end(args);
 
-    int result = vscanf(format, args);
-    if (result == EOF) { // we'll interpret Ctrl+D as a quit request
-        puts("");
-        exit(EXIT_SUCCESS);
+    if (session->state == SESSION_CLOSED)
+        return;
+    if (send(session->fd, message, length, MSG_NOSIGNAL | MSG_DONTWAIT) != length)
+        session->state = SESSION_CLOSED;
+}
+
+static void session_countdown(ServerWorker* worker, Session* session)
+{
+    base_t left_base  = server_rounds[session->round].left_base;
+    base_t right_base = server_rounds[session->round].right_base;
+    session_send(session, "Round %u: Convert %s to %s\nGet ready...\n",
+        session->round + 1u, base_lowercase[left_base], base_lowercase[right_base]);
+    session->state = SESSION_COUNTDOWN;
+    session->timer = timer_new(SERVER_COUNTDOWN);
+    deadline_heap_push(worker, session);
+}
+
+static void session_question(Session* session, bool again)
+{
+    char question[NUMBER_BUFFER_SIZE];
+    if ( ! again) {
+        game_round_next_question(&session->game);
+        session->asked_at = clock_now();
     }
-    while (getchar() != '\n') // flush input in case of failed vscanf()
-        ;
-    va_end(args);
+    format_number(question, session->game.left, session->game.left_base, 4);
+    session_send(session, "%s:\n", question);
+}
 
-    return result;
+static void session_start_round(ServerWorker* worker, Session* session)
+{
+    base_t left_base  = server_rounds[session->round].left_base;
+    base_t right_base = server_rounds[session->round].right_base;
+    static const float neutral[16] = { 1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1 };
+    session->game  = game_round_new(left_base, right_base, 4,
+        session_round_random_state(session->seed, left_base, right_base), &session->questions, neutral);
+    session->state = SESSION_ROUND;
+    session->timer = timer_new(ROUND_DURATION);
+    deadline_heap_push(worker, session);
+    session_question(session, false);
 }
 
-static size_t game(size_t round, base_t left_base, base_t right_base)
+// Asked again after blank and too long names like in terminal.
+static void session_ask_name(Session* session)
 {
-    GPRandomState rs = gp_random_state(time(NULL));
-    GPScope* scope = gp_begin(0);
+    session->state = SESSION_NAME;
+    session_send(session, "Enter name (max %zu bytes):\n", sizeof((LeaderBoardEntry*)0)->name);
+}
 
-    gp_println(
-        "Round", round, ": Convert", base_lowercase[left_base], "to", base_lowercase[right_base]);
-    gp_println("Get ready...");
+static void session_end_round(ServerWorker* worker, Session* session)
+{
+    base_t left_base  = server_rounds[session->round].left_base;
+    base_t right_base = server_rounds[session->round].right_base;
+    session->scores[0][0] += session->scores[left_base][right_base] = session->game.score;
+    session->reactions_ms[left_base][right_base] = game_round_reaction_ms(&session->game);
+    session_send(session, "Time's up!\nRound %u score: %u\n\n", session->round + 1u, (unsigned)session->game.score);
 
-    for (size_t countdown = 5; countdown != 0; --countdown) {
-        gp_print(countdown, "\r");
-        fflush(stdout);
-        game_time(TIME_RESET);
-        while (game_time(TIME_NOW) < 1.)
-            usleep(10);
+    if (++session->round < BASE_COMBINATIONS)
+        session_countdown(worker, session);
+    else {
+        deadline_heap_remove(worker, session);
+        session_ask_name(session);
     }
+}
 
-    uint32_t last_left = -1;
-    size_t score = 0;
-    game_time(TIME_RESET);
-    while (game_time(TIME_NOW) < ROUND_DURATION)
-    {
-        uint32_t right;
-        uint32_t left; do {
-            left = gp_random(&rs) & 0xF;
-        } while (left == last_left);
-        last_left = left;
+// Hands stats counted by worker over to submission by swapping buffers. If the
+// spare buffer is still with the submit thread, they are submitted when it
+// comes back instead.
+static void server_submit_stats(ServerWorker* worker, ServerSubmission* submission)
+{
+    worker->stats_deferred = worker->stats_spare == NULL;
+    if (worker->stats_deferred)
+        return;
+    submission->stats   = worker->stats;
+    worker->stats       = worker->stats_spare;
+    worker->stats_spare = NULL;
+}
 
-        try_again:;
-        size_t left_digits;
-        switch (left_base) {
-        case BASE2:
-            printf("%s: ", u4toa_binary(left));
-            left_digits = 1 + (left > 1); // we only care if larger than 1
-            break;
+static void server_submit(ServerWorker* worker, ServerSubmission* submission)
+{
+    while (write(worker->server->submit_fds[1], &submission, sizeof submission) != sizeof submission)
+        gp_assert(errno == EINTR, strerror(errno));
+}
 
-        case BASE10:
-            printf("%4u: ", left);
-            left_digits = snprintf(NULL, 0, "%u", left);
-            break;
+// Queues results to submit thread. Stats of the worker are submitted too,
+// including ones of sessions that didn't finish. The session is not polled
+// until results come back, so it cannot be closed in between.
+static void session_submit(ServerWorker* worker, Session* session, const char* name)
+{
+    ServerSubmission* submission = malloc(sizeof*submission);
+    gp_assert(submission != NULL);
+    *submission = (ServerSubmission){
+        .session   = session,
+        .worker    = worker,
+        .seed      = session->seed,
+        .timestamp = time(NULL),
+    };
+    memcpy(submission->name, name, strnlen(name, sizeof submission->name - 1));
+    memcpy(submission->scores,       session->scores,       sizeof submission->scores);
+    memcpy(submission->reactions_ms, session->reactions_ms, sizeof submission->reactions_ms);
+    server_submit_stats(worker, submission);
 
-        case BASE16:
-            printf(" 0x%X: ", left);
-            left_digits = snprintf(NULL, 0, "%x", left);
-            break;
+    gp_assert(epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL) != -1, strerror(errno));
+    session->state = SESSION_SUBMITTING;
+    server_submit(worker, submission);
+}
 
-        default: __builtin_unreachable();
-        }
-        gp_assert(0 < left_digits && left_digits <= 4);
-        gp_print("\n", GP_CURSOR_UP(1) GP_CURSOR_FORWARD(6)); // empty line to avoid scroll on WRONG
-        fflush(stdout);
+// Sends results of a submitted session, which is then closed.
+static void session_submitted(const ServerSubmission* submission)
+{
+    Session* session = submission->session;
+    if (submission->new_high_scores_length > 0)
+        session_send(session, "Got %zu new high scores!\n", submission->new_high_scores_length);
+    for (size_t i = 0; i < BASE_COMBINATIONS; ++i)
+        session_send(session, "%s to %s: %u\n",
+            base_titlecase[server_rounds[i].left_base], base_titlecase[server_rounds[i].right_base],
+            (unsigned)session->scores[server_rounds[i].left_base][server_rounds[i].right_base]);
+    session_send(session, "All Rounds Total: %u\nbye\n", (unsigned)session->scores[0][0]);
+    session->state = SESSION_CLOSED;
+}
 
-        size_t right_digits;
-        char right_base2_buf[8] = "";
-        switch (right_base) {
-        case BASE2:
-            printf("0b");
-            read_input("%5s", right_base2_buf);
-            right = atou4_binary(right_base2_buf);
-            right_digits = 1 + (right > 1); // we only care if larger than 1
+static void session_handle_line(ServerWorker* worker, Session* session, char* line)
+{
+    switch (session->state)
+    {
+    case SESSION_ROUND:
+        if (timer_expired(&session->timer)) { // timer event not handled yet
+            session_end_round(worker, session);
             break;
+        }
+        const double reaction_time = clock_diff(clock_now(), session->asked_at);
+        const uint64_t right = parse_answer(line, strlen(line), session->game.right_base);
+        size_t points = game_round_submit(&session->game, right, reaction_time);
+        stats_record(worker->stats, session->game.left_base, session->game.right_base,
+            session->game.left, points != 0, reaction_time);
+        char error[64];
+        if (points == 0 && right == NUMBER_INVALID) {
+            answer_error(error, sizeof error, line, strlen(line), session->game.right_base);
+            session_send(session, "WRONG (%s)\n", error);
+        } else if (points == 0)
+            session_send(session, "WRONG\n");
+        else
+            session_send(session, "Correct! +%zup | Score: %u | %.2f s\n",
+                points, (unsigned)session->game.score, reaction_time);
+        session_question(session, points == 0);
+        break;
 
-        case BASE10:
-            read_input("%u", &right);
-            right_digits = snprintf(NULL, 0, "%u", right);
-            break;
+    case SESSION_NAME:;
+        char name[sizeof session->input] = ""; // whole line fits
+        static_assert(sizeof name == 64, "Format of sscanf() must fit name.");
+        if (sscanf(line, "%63s", name) != 1)
+            session_ask_name(session);
+        else if (strlen(name) > sizeof((LeaderBoardEntry*)0)->name) {
+            session_send(session, "Name too long (%zu bytes).\n", strlen(name));
+            session_ask_name(session);
+        } else
+            session_submit(worker, session, name);
+        break;
 
-        case BASE16:
-            printf("0x");
-            read_input("%x", &right);
-            right_digits = snprintf(NULL, 0, "%x", right);
+    default: // typing during countdown is ignored like in terminal
+        break;
+    }
+}
+
+static void session_handle_input(ServerWorker* worker, Session* session)
+{
+    while (session->state != SESSION_CLOSED && session->state != SESSION_SUBMITTING)
+    {
+        ssize_t bytes_read = recv(session->fd,
+            session->input + session->input_length, sizeof session->input - session->input_length, 0);
+        if (bytes_read == -1 && errno == EINTR)
+            continue;
+        if (bytes_read == -1 && errno == EAGAIN)
+            break;
+        if (bytes_read <= 0) {
+            session->state = SESSION_CLOSED;
             break;
+        }
+        session->input_length += bytes_read;
 
-        default: __builtin_unreachable();
+        char* newline;
+        while (session->state != SESSION_CLOSED && session->state != SESSION_SUBMITTING &&
+            (newline = memchr(session->input, '\n', session->input_length)) != NULL)
+        {
+            *newline = '\0';
+            if ( ! session->truncating)
+                session_handle_line(worker, session, session->input);
+            session->truncating = false;
+            size_t consumed = newline + 1 - session->input;
+            memmove(session->input, newline + 1, session->input_length - consumed);
+            session->input_length -= consumed;
         }
+        if (session->input_length == sizeof session->input) { // too long line
+            if (session->state == SESSION_NAME && ! session->truncating) {
+                session_send(session, "Name too long (over %zu bytes).\n", sizeof session->input - 1);
+                session_ask_name(session);
+            }
+            session->truncating   = true;
+            session->input_length = 0;
+        }
+    }
+}
 
-        if (right != left) {
-            printf(GP_CURSOR_UP(1) GP_CURSOR_FORWARD(6));
-            if (right_base != BASE10) // skip 0x or 0b
-                printf(GP_CURSOR_FORWARD(2));
-            printf(GP_RED"WRONG                                              \r"GP_RESET_TERMINAL);
-            goto try_again;
+static void session_close(ServerWorker* worker, Session* session)
+{
+    deadline_heap_remove(worker, session);
+    close(session->fd);
+    session->next_closed = worker->closed;
+    worker->closed       = session;
+}
+
+// --------------------------------
+// Workers
+
+static void server_worker_accept(ServerWorker* worker)
+{
+    while (true)
+    {
+        int fd = accept(worker->server->listen_fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EMFILE || errno == ENFILE)
+                fprintf(stderr, "hexgame: accept() failed: %s\n", strerror(errno));
+            break; // EAGAIN or taken by another worker
         }
+        Session* session = aligned_alloc(_Alignof(Session), sizeof*session); // for game
+        if (session != NULL)
+            memset(session, 0, sizeof*session);
+        gp_assert(session != NULL);
+        session->fd         = fd;
+        session->heap_index = SESSION_NOT_IN_HEAP;
+        session->seed       = session_seed_new();
 
-        gp_print(GP_GREEN "Correct! ");
-        if (left_digits == 1 && right_digits == left_digits) {
-            score += 1;
-            gp_println(" +1p " GP_RESET_TERMINAL "(trivial conversion) | Score:", score);
-        } else {
-            score += 2;
-            gp_println(" +2p " GP_RESET_TERMINAL "(non-trivial points) | Score:", score);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = session };
+        if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1 || epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            free(session);
+            continue;
         }
-    } // while(game_time(TIME_NOW) < 30.)
+        session_countdown(worker, session);
+        if (session->state == SESSION_CLOSED)
+            session_close(worker, session);
+    }
+}
+
+static void server_worker_expire(ServerWorker* worker)
+{
+    uint64_t expirations;
+    if (read(worker->timer_fd, &expirations, sizeof expirations) != sizeof expirations)
+        return; // re-armed after expiring
 
-    gp_println("\nRound", round, "score:", score, "\n");
-    gp_end(scope);
-    return score;
+    // Kernel decides when armed deadline is reached, not our clock.
+    const clock_ns_t now = gp_max(clock_now(), worker->armed);
+    while (worker->heap_length > 0 && (int64_t)(worker->heap[0]->timer.deadline - now) <= 0)
+    {
+        Session* session = worker->heap[0];
+        deadline_heap_remove(worker, session);
+        if (session->state == SESSION_COUNTDOWN)
+            session_start_round(worker, session);
+        else if (session->state == SESSION_ROUND)
+            session_end_round(worker, session);
+        if (session->state == SESSION_CLOSED)
+            session_close(worker, session);
+    }
+    deadline_heap_arm(worker);
 }
 
-static void print_leaderboard_entry(
-    LeaderBoardEntry leaderboard[LEADERBOARD_MAX_LENGTH][BASE_LENGTH][BASE_LENGTH],
-    size_t leaderboard_length,
-    base_t left_base,
-    base_t right_base,
-    size_t round)
+// Deferred stats reuse the submission that brought the spare buffer back.
+static void server_worker_submitted(ServerWorker* worker)
 {
-    puts("-----------------------------------------------------------------");
-    if (left_base == 0 && right_base == 0)
-        printf("All Rounds Total\n");
-    else
-        printf("Round %zu: %s to %s\n", round, base_titlecase[left_base], base_titlecase[right_base]);
+    ServerSubmission* submission;
+    while (read(worker->submitted_fds[0], &submission, sizeof submission) == sizeof submission) {
+        if (submission->session != NULL) {
+            session_submitted(submission);
+            session_close(worker, submission->session);
+        }
+        if (submission->stats != NULL)
+            worker->stats_spare = submission->stats; // emptied by submit thread
+        if (worker->stats_deferred) {
+            *submission = (ServerSubmission){ .worker = worker };
+            server_submit_stats(worker, submission);
+            server_submit(worker, submission);
+        } else
+            free(submission);
+    }
+}
 
-    printf("   | %-*s | %-*s | Date\n",
-        (int)(sizeof leaderboard[0][0][0].name - sizeof""), "Name",
-        SCORE_FIELD_WIDTH, "Score");
-    puts("-----------------------------------------------------------------");
+// The only thread using leaderboard while serving.
+static int server_submit_loop(void* _server)
+{
+    Server* server = _server;
+    while (true)
+    {
+        ServerSubmission* submission;
+        ssize_t bytes_read = read(server->submit_fds[0], &submission, sizeof submission);
+        if (bytes_read == -1 && errno == EINTR)
+            continue;
+        gp_assert(bytes_read == sizeof submission, strerror(errno));
 
-    for (size_t i_entry = 0; i_entry < leaderboard_length; ++i_entry) {
-        LeaderBoardEntry entry = leaderboard[i_entry][left_base][right_base];
-        char date[128] = "";
-        gp_assert(strftime(date, sizeof date, "%c", localtime(&entry.timestamp)) != 0);
+        HighScorePosition new_high_scores[BASE_COMBINATIONS + 1];
+        if (submission->session != NULL)
+            submission->new_high_scores_length = leaderboard_submit(
+                server->leaderboard, 4, submission->seed, submission->scores, submission->reactions_ms,
+                submission->name, submission->timestamp, new_high_scores);
+        if (submission->stats != NULL) {
+            leaderboard_add_stats(server->leaderboard, submission->stats);
+            memset(submission->stats, 0, sizeof*submission->stats);
+        }
+        while (write(submission->worker->submitted_fds[1], &submission, sizeof submission) != sizeof submission)
+            gp_assert(errno == EINTR, strerror(errno));
+    }
+    return 0;
+}
 
-        printf("%2zu | %-*s | %-*zu | %s\n", i_entry+1,
-            (int)(sizeof entry.name - sizeof""),
-            entry.name,
-            SCORE_FIELD_WIDTH,
-            (size_t)entry.score,
-            date);
+static int server_worker_loop(void* _worker)
+{
+    ServerWorker* worker = _worker;
+    struct epoll_event events[256];
+    while (true)
+    {
+        int events_length = epoll_wait(worker->epoll_fd, events, sizeof events / sizeof events[0], -1);
+        if (events_length == -1) {
+            gp_assert(errno == EINTR, strerror(errno));
+            continue;
+        }
+        for (int i = 0; i < events_length; ++i)
+        {
+            if (events[i].data.u64 == SERVER_EVENT_TIMER) {
+                server_worker_expire(worker);
+                continue;
+            } else if (events[i].data.u64 == SERVER_EVENT_LISTEN) {
+                server_worker_accept(worker);
+                continue;
+            } else if (events[i].data.u64 == SERVER_EVENT_SUBMITTED) {
+                server_worker_submitted(worker);
+                continue;
+            }
+            Session* session = events[i].data.ptr;
+            if (session->state == SESSION_CLOSED || session->state == SESSION_SUBMITTING) // by earlier event
+                continue;
+            session_handle_input(worker, session);
+            if (session->state == SESSION_CLOSED)
+                session_close(worker, session);
+        }
+        while (worker->closed != NULL) {
+            Session* next = worker->closed->next_closed;
+            free(worker->closed);
+            worker->closed = next;
+        }
     }
-    puts("-----------------------------------------------------------------");
-    puts("");
+    return 0;
 }
 
-static void print_leaderboard(
-    LeaderBoardEntry leaderboard[LEADERBOARD_MAX_LENGTH][BASE_LENGTH][BASE_LENGTH],
-    size_t           leaderboard_length)
+static void raise_file_limit(void)
 {
-    if (leaderboard_length == 0) {
-        gp_println("No leaderboard data to show.");
-        return;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
     }
+}
 
-    puts("\n-----------------------------------------------------------------");
-    puts("    HEXGAME LEADERBOARD");
-    puts("-----------------------------------------------------------------\n");
+static void unix_socket_address(struct sockaddr_un* address, const char* path)
+{
+    *address = (struct sockaddr_un){ .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof address->sun_path) {
+        fprintf(stderr, "hexgame: socket path too long: %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(address->sun_path, path);
+}
 
-    size_t round = 0;
-    for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
-        for (base_t right_base = 0; right_base < BASE_LENGTH; ++right_base)
-            if (left_base == right_base)
-                continue;
-            else
-                print_leaderboard_entry(
-                    leaderboard, leaderboard_length, left_base, right_base, ++round);
-    print_leaderboard_entry(leaderboard, leaderboard_length, 0, 0, 0);
+// Never returns. Main thread becomes the first worker.
+static void serve(LeaderBoard* leaderboard, const char* socket_path)
+{
+    raise_file_limit();
+    static Server server;
+    server.leaderboard = leaderboard;
+    gp_assert(pipe(server.submit_fds) != -1, strerror(errno));
+    gp_assert(gp_thread_create(&server.submit_thread, server_submit_loop, &server) == 0);
+
+    struct sockaddr_un address;
+    unix_socket_address(&address, socket_path);
+    server.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(socket_path); // stale socket of previous server
+    if (server.listen_fd == -1
+        || bind(server.listen_fd, (struct sockaddr*)&address, sizeof address) == -1
+        || listen(server.listen_fd, SOMAXCONN) == -1)
+    {
+        fprintf(stderr, "hexgame: cannot listen %s: %s\n", socket_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    server.workers_length = gp_max(1l, gp_min(cpus, (long)SERVER_MAX_WORKERS));
+    for (size_t i = 0; i < server.workers_length; ++i)
+    {
+        ServerWorker* worker = &server.workers[i];
+        *worker = (ServerWorker){
+            .server   = &server,
+            .epoll_fd = epoll_create1(EPOLL_CLOEXEC),
+            .timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+        };
+        worker->stats       = &worker->stats_buffers[0];
+        worker->stats_spare = &worker->stats_buffers[1];
+        gp_assert(worker->epoll_fd != -1 && worker->timer_fd != -1, strerror(errno));
+        gp_assert(pipe(worker->submitted_fds) != -1, strerror(errno));
+        gp_assert(fcntl(worker->submitted_fds[0], F_SETFL, O_NONBLOCK) != -1, strerror(errno));
+
+        // Exclusive so one connection only wakes up one worker.
+        struct epoll_event listen_event    = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.u64 = SERVER_EVENT_LISTEN };
+        struct epoll_event timer_event     = { .events = EPOLLIN, .data.u64 = SERVER_EVENT_TIMER };
+        struct epoll_event submitted_event = { .events = EPOLLIN, .data.u64 = SERVER_EVENT_SUBMITTED };
+        gp_assert(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &listen_event) != -1, strerror(errno));
+        gp_assert(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->timer_fd, &timer_event) != -1, strerror(errno));
+        gp_assert(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->submitted_fds[0], &submitted_event) != -1,
+            strerror(errno));
+        if (i > 0)
+            gp_assert(gp_thread_create(&worker->thread, server_worker_loop, worker) == 0);
+    }
+    printf("hexgame: serving %s with %zu workers\n", socket_path, server.workers_length);
+    fflush(stdout);
+    server_worker_loop(&server.workers[0]);
 }
 
-static void print_score(
-    score_t score,
-    base_t  left_base,
-    base_t  right_base,
-    int     high_score_rank)
+// --------------------------------
+// Test Client
+//
+// Drives many sessions of a server at once, answering correctly every think
+// seconds. Useful for load testing and holding lots of idle sessions.
+
+typedef struct client_session
 {
-    char round_name[128];
+    int      fd;
+    base_t   left_base;
+    base_t   right_base;
+    bool     has_question;
+    uint32_t question;
+    uint16_t input_length;
+    char     input[256];
+} ClientSession;
 
-    size_t longest = 0;
-    for (size_t base = 0; base < BASE_LENGTH; ++base)
-        if (strlen(base_lowercase[base]) > longest)
-            longest = strlen(base_lowercase[base]);
-    const int round_name_width = 2*longest + (sizeof" to "-1);
+typedef struct client_stats
+{
+    size_t connected;
+    size_t finished;
+    size_t answers;
+    size_t correct;
+} ClientStats;
 
-    if (left_base == 0 && right_base == 0)
-        strcpy(round_name, "All Rounds Total");
-    else
-        strcat(strcat(strcpy(
-            round_name, base_titlecase[left_base]), " to "), base_titlecase[right_base]);
+static base_t base_from_name(const char* name)
+{
+    for (base_t base = 0; base < BASE_LENGTH; ++base)
+        if (strcmp(name, base_lowercase[base]) == 0)
+            return base;
+    return BASE10;
+}
 
-    printf("%-*s : %*zu ", round_name_width, round_name, SCORE_FIELD_WIDTH, (size_t)score);
-    if (high_score_rank) {
-        printf("(top %i!) ", high_score_rank);
-        const char* medals[] = {"", "🥇", "🥈", "🥉"};
-        if (high_score_rank <= 3)
-            printf("%s", medals[high_score_rank]);
+static void client_handle_line(ClientSession* session, ClientStats* stats, const char* line, const char* name)
+{
+    char left_name[16], right_name[16], question[16];
+    unsigned round;
+    if (sscanf(line, "Round %u: Convert %15s to %15s", &round, left_name, right_name) == 3) {
+        session->left_base  = base_from_name(left_name);
+        session->right_base = base_from_name(right_name);
     }
-    puts("");
+    else if (sscanf(line, "%15[0-9a-fA-Fx]:", question) == 1 && line[strlen(question)] == ':') {
+        session->question     = parse_answer(question, strlen(question), session->left_base);
+        session->has_question = true;
+    }
+    else if (strncmp(line, "Correct!", sizeof"Correct!"-1) == 0)
+        ++stats->correct;
+    else if (strncmp(line, "Time's up!", sizeof"Time's up!"-1) == 0)
+        session->has_question = false;
+    else if (strncmp(line, "Enter name", sizeof"Enter name"-1) == 0)
+        dprintf(session->fd, "%s\n", name);
+    else if (strcmp(line, "bye") == 0) {
+        ++stats->finished;
+        close(session->fd);
+        session->fd = -1;
+    }
+}
+
+static void client(const char* socket_path, size_t sessions_length, double think, const char* name)
+{
+    raise_file_limit();
+    struct sockaddr_un address;
+    unix_socket_address(&address, socket_path);
+
+    ClientSession* sessions = calloc(sessions_length, sizeof sessions[0]);
+    gp_assert(sessions != NULL);
+    ClientStats stats = {0};
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    gp_assert(epoll_fd != -1, strerror(errno));
+
+    for (size_t i = 0; i < sessions_length; ++i) {
+        sessions[i].fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sessions[i].fd == -1 || connect(sessions[i].fd, (struct sockaddr*)&address, sizeof address) == -1) {
+            fprintf(stderr, "hexgame: cannot connect %s: %s\n", socket_path, strerror(errno));
+            if (sessions[i].fd != -1)
+                close(sessions[i].fd);
+            sessions[i].fd = -1;
+            continue;
+        }
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = &sessions[i] };
+        gp_assert(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sessions[i].fd, &event) != -1, strerror(errno));
+        ++stats.connected;
+    }
+    printf("hexgame: connected %zu sessions\n", stats.connected);
+    fflush(stdout);
+
+    Timer think_timer = timer_new(think);
+    Timer report_timer = timer_new(1.);
+    while (stats.finished < stats.connected)
+    {
+        struct epoll_event events[256];
+        int timeout_ms = gp_min(timer_remaining(&think_timer), 1.) * 1000.;
+        int events_length = epoll_wait(epoll_fd, events, sizeof events / sizeof events[0], gp_max(timeout_ms, 0));
+        for (int i = 0; i < events_length; ++i)
+        {
+            ClientSession* session = events[i].data.ptr;
+            ssize_t bytes_read = read(session->fd,
+                session->input + session->input_length, sizeof session->input - session->input_length);
+            if (bytes_read <= 0) {
+                ++stats.finished; // server hung up
+                close(session->fd);
+                session->fd = -1;
+                continue;
+            }
+            session->input_length += bytes_read;
+            char* newline;
+            while (session->fd != -1 && (newline = memchr(session->input, '\n', session->input_length)) != NULL) {
+                *newline = '\0';
+                client_handle_line(session, &stats, session->input, name);
+                size_t consumed = newline + 1 - session->input;
+                memmove(session->input, newline + 1, session->input_length - consumed);
+                session->input_length -= consumed;
+            }
+            if (session->input_length == sizeof session->input)
+                session->input_length = 0;
+        }
+
+        if (timer_expired(&think_timer)) {
+            for (size_t i = 0; i < sessions_length; ++i) {
+                ClientSession* session = &sessions[i];
+                if (session->fd == -1 || ! session->has_question)
+                    continue;
+                char answer[NUMBER_BUFFER_SIZE];
+                format_number(answer, session->question, session->right_base, 4);
+                dprintf(session->fd, "%s\n", answer);
+                session->has_question = false;
+                ++stats.answers;
+            }
+            timer_extend(&think_timer, think);
+            if (timer_expired(&think_timer)) // fell behind
+                think_timer = timer_new(think);
+        }
+        if (timer_expired(&report_timer)) {
+            printf("hexgame: %zu sessions, %zu finished, %zu answers, %zu correct\n",
+                stats.connected, stats.finished, stats.answers, stats.correct);
+            fflush(stdout);
+            timer_extend(&report_timer, 1.);
+        }
+    }
+    printf("hexgame: %zu sessions, %zu finished, %zu answers, %zu correct\n",
+        stats.connected, stats.finished, stats.answers, stats.correct);
+    free(sessions);
 }
 
+#endif // __linux__
+
 int main(int argc, char** argv, char** envp)
 {
-    // Overlapping indices are empty, so we'll use [0][0] for sum. Also, user
-    // has unlimited time for the last question, so they are guaranteed to have
-    // at least one point.
+    // Overlapping indices are empty, so we'll use [0][0] for sum.
     score_t scores[BASE_LENGTH][BASE_LENGTH] = {0};
-    LeaderBoardEntry leaderboard[LEADERBOARD_MAX_LENGTH][BASE_LENGTH][BASE_LENGTH] = {0};
-    size_t leaderboard_length = 0;
-    int leaderboard_fd = -1;
+    LeaderBoard leaderboard;
 
     // --------------------------------
     #if _WIN32 // Enable ANSI Colors
@@ -344,6 +5461,24 @@ int main(int argc, char** argv, char** envp)
     SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
     #endif
 
+    clock_init();
+
+    // Counters are printed at exit whatever the command, so --stats is taken
+    // out before parsing arguments.
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stats") != 0)
+            continue;
+        #if HEXGAME_COUNTERS
+        atexit(counters_print);
+        #else
+        fprintf(stderr, "hexgame: --stats needs a build with -DHEXGAME_COUNTERS, see make counters.\n");
+        exit(EXIT_FAILURE);
+        #endif
+        memmove(&argv[i], &argv[i + 1], (argc - i) * sizeof argv[0]); // with NULL of argv[argc]
+        --argc;
+        break;
+    }
+
     // --------------------------------
     // Create/Read Leaderboard
 
@@ -364,51 +5499,273 @@ int main(int argc, char** argv, char** envp)
     #if _WIN32
     #define mkdir(A, ...) mkdir(A)
     #endif
-    if (access(leaderboard_path, F_OK) == -1 && mkdir(leaderboard_path, 0766) == -1)
+    // verify only plays seeds in memory, so it must not create, migrate or
+    // write any files of the user, which release builds rely on for training.
+    const bool in_memory = argc >= 2 && strcmp(argv[1], "verify") == 0;
+    const char* leaderboard_dir = in_memory ? NULL : leaderboard_path;
+    if ( ! in_memory && access(leaderboard_path, F_OK) == -1 && mkdir(leaderboard_path, 0766) == -1) {
         gp_file_println(stderr,
             "hexgame: cannot create", leaderboard_path, "for leaderboards:",
             strerror(errno));
-
-    else if (access(strcat(leaderboard_path, "/leaderboard.bin"), F_OK) != -1 &&
-        (leaderboard_fd = open(leaderboard_path, O_RDONLY)) == -1)
-
-        fprintf(stderr,
-            "hexgame: cannot open %s: %s\n", leaderboard_path, strerror(errno));
-    else if (leaderboard_fd != -1) {
-        leaderboard_length = read(leaderboard_fd, leaderboard, sizeof leaderboard);
-        if (leaderboard_length == (size_t)-1)
-            gp_file_println(stderr,
-                "hexgame: could not read leaderboard data from %s:",
-                leaderboard_path,
-                strerror(errno));
-        else
-            leaderboard_length /= sizeof leaderboard[0];
-
-        gp_assert(close(leaderboard_fd) != -1, strerror(errno));
+        leaderboard_dir = NULL;
     }
+    leaderboard_open(&leaderboard, leaderboard_dir);
 
     // --------------------------------
     // Check Arguments
 
-    if (argc == 2 && strcmp(argv[1], "leaderboard") == 0) {
-        print_leaderboard(leaderboard, leaderboard_length);
+    FILE* record = NULL;
+    unsigned bits = 4;
+    uint32_t seed = 0;
+    if (argc >= 2 && strcmp(argv[1], "leaderboard") == 0) {
+        LeaderBoardQuery query = { .since = INT64_MIN, .top = LEADERBOARD_MAX_LENGTH };
+        bool global = false;
+        for (int i = 2; i < argc; ++i) {
+            const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+            char* end = NULL;
+            if (strcmp(argv[i], "--global") == 0) {
+                global = true;
+                continue;
+            } else if (value == NULL) {
+                gp_file_println(stderr, usage);
+                exit(EXIT_FAILURE);
+            } else if (strcmp(argv[i], "--round") == 0) {
+                if ( ! query_parse_round(&query, value)) {
+                    fprintf(stderr, "hexgame: unknown round %s, expected like bin2hex or total.\n", value);
+                    exit(EXIT_FAILURE);
+                }
+            } else if (strcmp(argv[i], "--since") == 0) {
+                if ( ! query_parse_date(value, &query.since)) {
+                    fprintf(stderr, "hexgame: invalid date %s, expected like 2025-01-31 or 2025-01-31T18:00.\n", value);
+                    exit(EXIT_FAILURE);
+                }
+            } else if (strcmp(argv[i], "--name") == 0) {
+                if (strlen(value) > sizeof((LeaderBoardEntry*)0)->name) {
+                    fprintf(stderr, "hexgame: name too long (%zu bytes).\n", strlen(value));
+                    exit(EXIT_FAILURE);
+                }
+                query.name = value;
+            } else if (strcmp(argv[i], "--top") == 0) {
+                query.top = strtoull(value, &end, 10);
+                if (end == value || *end != '\0') {
+                    fprintf(stderr, "hexgame: invalid number %s.\n", value);
+                    exit(EXIT_FAILURE);
+                }
+            } else if (strcmp(argv[i], "--format") == 0) {
+                if (strcmp(value, "text") == 0)
+                    query.format = QUERY_TEXT;
+                else if (strcmp(value, "csv") == 0)
+                    query.format = QUERY_CSV;
+                else if (strcmp(value, "json") == 0)
+                    query.format = QUERY_JSON;
+                else {
+                    fprintf(stderr, "hexgame: unknown format %s, expected text, csv or json.\n", value);
+                    exit(EXIT_FAILURE);
+                }
+            } else {
+                gp_file_println(stderr, usage);
+                exit(EXIT_FAILURE);
+            }
+            ++i;
+        }
+        if (global) {
+            #if _WIN32
+            fprintf(stderr, "hexgame: --global is not supported on this platform.\n");
+            exit(EXIT_FAILURE);
+            #else
+            char own_path[4096 + sizeof"/leaderboard.bin"];
+            snprintf(own_path, sizeof own_path, "%s/leaderboard.bin", leaderboard_path);
+            LeaderBoard merged;
+            leaderboard_global(&merged, leaderboard_dir, leaderboard.fd != -1 ? own_path : NULL, &query);
+            print_leaderboard_query(&merged, NULL, query);
+            leaderboard_close(&merged);
+            exit(EXIT_SUCCESS);
+            #endif
+        }
+        char history_path[4096 + sizeof"/history.bin"];
+        snprintf(history_path, sizeof history_path, "%s/history.bin", leaderboard_path);
+        print_leaderboard_query(&leaderboard, leaderboard.history_fd == -1 ? NULL : history_path, query);
         exit(EXIT_SUCCESS);
-    } else if (argc == 2 && strcmp(argv[1], "--help") == 0) {
-        gp_println("hexgame: pass no arguments to play or 'leaderboard' to show leaderboard.");
+    } else if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        static Stats stats;
+        leaderboard_load_stats(&leaderboard, &stats);
+        print_stats(&stats);
+        exit(EXIT_SUCCESS);
+    } else if (argc >= 2 && strcmp(argv[1], "replay") == 0) {
+        const char* path = NULL;
+        const char* name = NULL;
+        for (int i = 2; i < argc; ++i) {
+            if (strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+                name = argv[++i];
+            else if (path == NULL)
+                path = argv[i];
+            else {
+                gp_file_println(stderr, usage);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (name != NULL && strlen(name) > sizeof((LeaderBoardEntry*)0)->name) {
+            fprintf(stderr, "hexgame: name too long (%zu bytes).\n", strlen(name));
+            exit(EXIT_FAILURE);
+        }
+        FILE* in = path == NULL ? stdin : fopen(path, "r");
+        if (in == NULL) {
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        replay(&leaderboard, in, name);
+        leaderboard_close(&leaderboard);
+        exit(EXIT_SUCCESS);
+    } else if (argc >= 3 && strcmp(argv[1], "verify") == 0) {
+        const char* path = NULL;
+        size_t questions = 16;
+        bool answers = false;
+        char* end = NULL;
+        unsigned long long _seed = strtoull(argv[2], &end, 10);
+        if (end == argv[2] || *end != '\0' || _seed == 0 || _seed > UINT32_MAX) {
+            fprintf(stderr, "hexgame: seed must be from 1 to %lu.\n", (unsigned long)UINT32_MAX);
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 3; i < argc; ++i) {
+            if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc) {
+                bits = strtoul(argv[++i], NULL, 10);
+                if (bits != 4 && bits != 8 && bits != 16 && bits != 32) {
+                    fprintf(stderr, "hexgame: bits must be 4, 8, 16 or 32.\n");
+                    exit(EXIT_FAILURE);
+                }
+            } else if (strcmp(argv[i], "--questions") == 0 && i + 1 < argc)
+                questions = strtoull(argv[++i], NULL, 10);
+            else if (strcmp(argv[i], "--answers") == 0)
+                answers = true;
+            else if (path == NULL)
+                path = argv[i];
+            else {
+                gp_file_println(stderr, usage);
+                exit(EXIT_FAILURE);
+            }
+        }
+        FILE* in = NULL;
+        if (path != NULL && (in = fopen(path, "r")) == NULL) {
+            fprintf(stderr, "hexgame: cannot open %s: %s\n", path, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        exit(verify(_seed, bits, questions, answers, in) ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (argc >= 2 && strcmp(argv[1], "analyze") == 0) {
+        const char** paths = malloc(argc * sizeof paths[0]);
+        gp_assert(paths != NULL);
+        size_t paths_length = 0;
+        #if _WIN32
+        size_t threads = 1;
+        #else
+        size_t threads = gp_max(1l, sysconf(_SC_NPROCESSORS_ONLN));
+        #endif
+        for (int i = 2; i < argc; ++i) {
+            char* end = NULL;
+            if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                threads = strtoull(argv[++i], &end, 10);
+                if (end == argv[i] || *end != '\0' || threads == 0) {
+                    fprintf(stderr, "hexgame: invalid number %s.\n", argv[i]);
+                    exit(EXIT_FAILURE);
+                }
+            } else
+                paths[paths_length++] = argv[i];
+        }
+        char events_path[4096 + sizeof"/events.bin"];
+        snprintf(events_path, sizeof events_path, "%s/events.bin", leaderboard_path);
+        if (paths_length == 0)
+            paths[paths_length++] = events_path;
+        const bool success = analyze(paths, paths_length, threads);
+        free(paths);
+        exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    } else if (argc >= 2 && (strcmp(argv[1], "serve") == 0 || strcmp(argv[1], "client") == 0)) {
+        #if __linux__
+        char socket_path[4096 + sizeof"/server.sock"];
+        strcpy(socket_path, leaderboard_path);
+        strcat(socket_path, "/server.sock");
+        size_t sessions = 1;
+        double think = 1.;
+        const char* name = "client";
+        bool has_path = false;
+        for (int i = 2; i < argc; ++i) {
+            if (argv[1][0] == 'c' && strcmp(argv[i], "--sessions") == 0 && i + 1 < argc)
+                sessions = strtoull(argv[++i], NULL, 10);
+            else if (argv[1][0] == 'c' && strcmp(argv[i], "--think") == 0 && i + 1 < argc)
+                think = strtod(argv[++i], NULL);
+            else if (argv[1][0] == 'c' && strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+                name = argv[++i];
+            else if ( ! has_path && strlen(argv[i]) < sizeof socket_path) {
+                strcpy(socket_path, argv[i]);
+                has_path = true;
+            } else {
+                gp_file_println(stderr, usage);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (argv[1][0] == 's')
+            serve(&leaderboard, socket_path);
+        client(socket_path, sessions, think, name);
+        leaderboard_close(&leaderboard);
         exit(EXIT_SUCCESS);
-    } else if (argc != 1) {
-        gp_file_println(stderr, "hexgame: pass no arguments to play or 'leaderboard' to show leaderboard.");
+        #else
+        fprintf(stderr, "hexgame: %s is not supported on this platform.\n", argv[1]);
         exit(EXIT_FAILURE);
+        #endif
+    } else if (argc == 2 && strcmp(argv[1], "--help") == 0) {
+        gp_println(usage);
+        exit(EXIT_SUCCESS);
+    } else for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc && record == NULL) {
+            if ((record = fopen(argv[++i], "w")) == NULL) {
+                fprintf(stderr, "hexgame: cannot open %s: %s\n", argv[i], strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc) {
+            bits = strtoul(argv[++i], NULL, 10);
+            if (bits != 4 && bits != 8 && bits != 16 && bits != 32) {
+                fprintf(stderr, "hexgame: bits must be 4, 8, 16 or 32.\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            char* end = NULL;
+            unsigned long long _seed = strtoull(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || _seed == 0 || _seed > UINT32_MAX) {
+                fprintf(stderr, "hexgame: seed must be from 1 to %lu.\n", (unsigned long)UINT32_MAX);
+                exit(EXIT_FAILURE);
+            }
+            seed = _seed;
+        } else {
+            gp_file_println(stderr, usage);
+            exit(EXIT_FAILURE);
+        }
     }
 
     // --------------------------------
     // Start Game
 
-    HighScorePosition new_high_scores[BASE_COMBINATIONS + 1]; // +1 for total
+    Input input;
+    input_init(&input, STDIN_FILENO);
+    static Stats stats;
+    // Given seeds are for tournaments, where everyone gets the same questions
+    // regardless of their past mistakes.
+    Schedule schedule;
+    leaderboard_load_schedule(&leaderboard, &schedule, time(NULL));
+    const Schedule* adaptive = seed == 0 ? &schedule : NULL;
+    if (seed == 0)
+        seed = session_seed_new();
+    uint16_t reactions_ms[BASE_LENGTH][BASE_LENGTH] = {0};
 
-    size_t new_high_scores_length = 0;
+    const char* user = getenv("USER");
+    Live live;
+    live_open(&live, leaderboard_dir, user != NULL ? user : "player");
+    EventLog events;
+    event_log_open(&events, leaderboard_dir, user != NULL ? user : "player", seed, bits);
 
     puts(header);
+    printf("Session %lu\n", (unsigned long)seed);
+    fflush(stdout); // rounds are drawn by renderer
+    Renderer renderer;
+    renderer_init(&renderer, STDOUT_FILENO);
+    input_raw_mode(&input, true);
     size_t round = 0;
     for (base_t left_base = 0; left_base < BASE_LENGTH; ++left_base)
     {
@@ -417,72 +5774,43 @@ int main(int argc, char** argv, char** envp)
             if (left_base == right_base)
                 continue;
 
-            scores[0][0] += scores[left_base][right_base] = game(round, left_base, right_base);
-
-            for (size_t i = 0; i < LEADERBOARD_MAX_LENGTH; ++i) {
-                if (scores[left_base][right_base] >= leaderboard[i][left_base][right_base].score) {
-                    new_high_scores[new_high_scores_length++] = (HighScorePosition)
-                        { left_base, right_base, i };
-                    break;
-                }
-            }
-        }
-    }
-    for (size_t i = 0; i < LEADERBOARD_MAX_LENGTH; ++i) {
-        if (scores[0][0] >= leaderboard[i][0][0].score) {
-            new_high_scores[new_high_scores_length++] = (HighScorePosition){0,0,i};
-            break;
+            scores[0][0] += scores[left_base][right_base] = game(
+                round, left_base, right_base, bits, &renderer, &input, record, &events, seed, adaptive, &stats, &live,
+                &reactions_ms[left_base][right_base]);
         }
     }
+    input_raw_mode(&input, false);
+    renderer_delete(&renderer);
+    live_close(&live);
     time_t timestamp = time(NULL);
+    if (record != NULL)
+        fclose(record);
 
     // --------------------------------
     // Update Leaderboard
 
     char nick[128] = "";
 
-    if (new_high_scores_length > 0) {
-        try_again:;
-        printf("Enter name (max %zu bytes): ", sizeof leaderboard[0][0][0].name);
-        fflush(stdout);
-        read_input("%127s", nick);
-
-        if (strlen(nick) > sizeof leaderboard[0][0][0].name) {
-            printf("Name too long (%zu bytes).\n", strlen(nick));
-            goto try_again;
-        }
-    }
-
-    for (size_t i = 0; i < new_high_scores_length; ++i)
-    {
-        HighScorePosition hi_score = new_high_scores[i];
+    // Every result goes to history, so we need the name even without high scores.
+    try_again:;
+    printf("Enter name (max %zu bytes): ", sizeof((LeaderBoardEntry*)0)->name);
+    fflush(stdout);
+    char line[sizeof nick];
+    read_input(&input, NULL, line, sizeof line);
+    sscanf(line, "%127s", nick);
 
-        for (size_t j = leaderboard_length - 1; j+1 >= hi_score.position+1; --j)
-            if (j == LEADERBOARD_MAX_LENGTH - 1)
-                continue;
-            else
-                leaderboard[j + 1][hi_score.left_base][hi_score.right_base] =
-                leaderboard[j + 0][hi_score.left_base][hi_score.right_base] ;
-
-        LeaderBoardEntry new_entry = { "", timestamp, scores[hi_score.left_base][hi_score.right_base] };
-        strcpy(new_entry.name, nick);
-        leaderboard[hi_score.position][hi_score.left_base][hi_score.right_base] = new_entry;
-    }
-    bool should_update_leaderboard = new_high_scores_length > 0;
-    if (leaderboard_length < LEADERBOARD_MAX_LENGTH) {
-        should_update_leaderboard = true;
-        ++leaderboard_length;
+    if (strlen(nick) > sizeof((LeaderBoardEntry*)0)->name) {
+        printf("Name too long (%zu bytes).\n", strlen(nick));
+        goto try_again;
     }
 
-    if (should_update_leaderboard)
-    {
-        if ((leaderboard_fd = open(leaderboard_path, O_CREAT | O_WRONLY, 0644)) == -1)
-            fprintf(stderr, "hexgame: could not open %s: %s\n", leaderboard_path, strerror(errno));
-        else if (write(leaderboard_fd, leaderboard, leaderboard_length * sizeof leaderboard[0]) == -1)
-            fprintf(stderr, "hexgame: could not write to %s: %s\n", leaderboard_path, strerror(errno));
-
-        if (leaderboard_fd != -1)
-            gp_assert(close(leaderboard_fd) != -1, strerror(errno));
+    event_log_close(&events, scores[0][0], nick);
+    HighScorePosition new_high_scores[BASE_COMBINATIONS + 1]; // +1 for total
+    size_t new_high_scores_length = leaderboard_submit(
+        &leaderboard, bits, seed, scores, reactions_ms, nick, timestamp, new_high_scores);
+    if (bits == 4) {
+        leaderboard_add_stats(&leaderboard, &stats);
+        leaderboard_update_schedule(&leaderboard, &stats, timestamp);
     }
 
     // --------------------------------
@@ -493,7 +5821,7 @@ int main(int argc, char** argv, char** envp)
         high_score_ranks[new_high_scores[i].left_base][new_high_scores[i].right_base] =
             new_high_scores[i].position + 1;
 
-    print_leaderboard(leaderboard, leaderboard_length);
+    print_leaderboard(&leaderboard);
 
     if (new_high_scores_length > 0)
         gp_println(GP_GREEN "Got", new_high_scores_length, "new high scores!" GP_RESET_TERMINAL);
@@ -507,8 +5835,12 @@ int main(int argc, char** argv, char** envp)
             else
                 print_score(
                     scores[left_base][right_base],
+                    reactions_ms[left_base][right_base],
                     left_base, right_base,
                     high_score_ranks[left_base][right_base]);
-    print_score(scores[0][0], 0, 0, high_score_ranks[0][0]);
+    print_score(scores[0][0], reactions_ms[0][0], 0, 0, high_score_ranks[0][0]);
     puts("");
+
+    leaderboard_close(&leaderboard);
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,186 @@
+// MIT License
+// Copyright (c) 2025 Lauri Lorenzo Fiestas
+// https://github.com/PrinssiFiestas/hexgame/blob/main/LICENSE.md
+
+// Stress test of concurrent leaderboard writers, built and run by make stress.
+// Forked processes insert scores to the same rounds of one leaderboard.bin
+// while the parent keeps reading it. Readers must only ever see complete,
+// sorted slots and the rounds must end up with exactly the best
+// LEADERBOARD_MAX_LENGTH scores of all writers, so no insert got lost to
+// another writer committing the same round. Exits with failure otherwise.
+//
+// Usage: hexgame-stress [WRITERS [INSERTS]]
+//
+// INSERTS is per writer and round. Scores of all writers are a permutation of
+// 1 to WRITERS * INSERTS, so every score is unique and the expected top is
+// known without running anything sequentially.
+
+#define main hexgame_main // stress test needs the internals, not the game
+#include "hexgame.c"
+#undef main
+
+#if !_WIN32
+#include <sys/wait.h>
+#endif
+
+#define STRESS_WRITERS 8
+#define STRESS_INSERTS 1000
+#define STRESS_PRIME   7919 // coprime with every score count, see stress_score()
+
+static const base_t stress_rounds[][2] = {
+    { BASE2,  BASE16 },
+    { BASE16, BASE2  },
+    { BASE10, BASE16 },
+};
+#define STRESS_ROUNDS (sizeof stress_rounds / sizeof stress_rounds[0])
+
+static size_t stress_writers = STRESS_WRITERS;
+static size_t stress_inserts = STRESS_INSERTS;
+
+// Insert i of all writers, derived from seed of entry to detect torn entries.
+static score_t stress_score(uint32_t seed)
+{
+    const size_t total = stress_writers * stress_inserts;
+    return (size_t)seed * STRESS_PRIME % total + 1;
+}
+
+static bool stress_failed = false;
+
+static void stress_fail(const char* what, size_t round, size_t position)
+{
+    fprintf(stderr, "hexgame: stress failed, %s at round %zu position %zu\n", what, round, position);
+    stress_failed = true;
+}
+
+// Checks that a round is sorted and scores match their seeds. Sequences are
+// not checked, they are outside of checksum, so unlocked readers may pick the
+// older slot while the newer one gets overwritten, which is only stale.
+static void stress_check_round(const LeaderBoard* lb, size_t round)
+{
+    const LeaderBoardSlot* slot = leaderboard_round(lb, stress_rounds[round][0], stress_rounds[round][1]);
+    LeaderBoardSlot copy;
+    memcpy(&copy, slot, sizeof copy); // writers keep going
+    if ( ! leaderboard_slot_is_valid(&copy) && copy.sequence != 0)
+        return; // overwritten while copying, next read gets it
+    if (le32(copy.length) > LEADERBOARD_MAX_LENGTH)
+        stress_fail("too long", round, le32(copy.length));
+    for (size_t i = 0; i < le32(copy.length) && i < LEADERBOARD_MAX_LENGTH; ++i) {
+        if (le16(copy.entries[i].score) != stress_score(le32(copy.entries[i].seed)))
+            stress_fail("torn entry", round, i);
+        if (i > 0 && le16(copy.entries[i].score) >= le16(copy.entries[i - 1].score))
+            stress_fail("unsorted", round, i);
+    }
+}
+
+#if !_WIN32
+static void stress_write(const char* dir, size_t writer)
+{
+    LeaderBoard lb;
+    leaderboard_open(&lb, dir);
+    if (lb.fd == -1)
+        exit(EXIT_FAILURE);
+    LeaderBoardEntry entry = { .reaction_ms = le16(1500) };
+    snprintf(entry.name, sizeof entry.name, "writer%u", (unsigned)(uint16_t)writer);
+    for (size_t i = 0; i < stress_inserts; ++i) {
+        const uint32_t seed = i * stress_writers + writer;
+        entry.timestamp = le64(i);
+        entry.seed      = le32(seed);
+        entry.score     = le16(stress_score(seed));
+        for (size_t round = 0; round < STRESS_ROUNDS; ++round)
+            leaderboard_insert(&lb, stress_rounds[round][0], stress_rounds[round][1], &entry);
+    }
+    leaderboard_close(&lb);
+    exit(EXIT_SUCCESS);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    #if _WIN32
+    (void)argc; (void)argv;
+    fprintf(stderr, "hexgame: stress test needs fork(), Windows has no concurrent writers.\n");
+    return EXIT_FAILURE;
+    #else
+    if (argc > 1)
+        stress_writers = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        stress_inserts = strtoul(argv[2], NULL, 10);
+    if (stress_writers == 0 || stress_inserts == 0 || stress_writers * stress_inserts > UINT16_MAX
+        || (stress_writers * stress_inserts) % STRESS_PRIME == 0) {
+        fprintf(stderr, "hexgame: usage: hexgame-stress [WRITERS [INSERTS]], "
+            "with WRITERS * INSERTS up to %u\n", (unsigned)UINT16_MAX);
+        return EXIT_FAILURE;
+    }
+    clock_init();
+
+    char dir[4096];
+    const char* tmp = getenv("TMPDIR");
+    snprintf(dir, sizeof dir, "%s/hexgame-stress-XXXXXX", tmp != NULL ? tmp : "/tmp");
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "hexgame: cannot create %s: %s\n", dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    LeaderBoard lb; // created before forking, so writers don't race to create it
+    leaderboard_open(&lb, dir);
+    if (lb.fd == -1) {
+        fprintf(stderr, "hexgame: cannot create leaderboard in %s\n", dir);
+        return EXIT_FAILURE;
+    }
+
+    const clock_ns_t start = clock_now();
+    for (size_t writer = 0; writer < stress_writers; ++writer) {
+        pid_t pid = fork();
+        if (pid == 0)
+            stress_write(dir, writer);
+        gp_assert(pid != -1, strerror(errno));
+    }
+
+    // Read while writing through the same shared mapping.
+    size_t   reads = 0;
+    size_t   running = stress_writers;
+    while (running > 0) {
+        for (size_t round = 0; round < STRESS_ROUNDS; ++round, ++reads)
+            stress_check_round(&lb, round);
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            --running;
+            if ( ! WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                fprintf(stderr, "hexgame: stress failed, writer %ld did not exit successfully\n", (long)pid);
+                stress_failed = true;
+            }
+        }
+    }
+    const double seconds = clock_diff(clock_now(), start);
+    leaderboard_close(&lb);
+
+    // Final contents from disk as a new process would see them.
+    leaderboard_open(&lb, dir);
+    const size_t total = stress_writers * stress_inserts;
+    for (size_t round = 0; round < STRESS_ROUNDS; ++round) {
+        stress_check_round(&lb, round);
+        const LeaderBoardSlot* slot = leaderboard_round(&lb, stress_rounds[round][0], stress_rounds[round][1]);
+        const size_t expected_length = gp_min(total, (size_t)LEADERBOARD_MAX_LENGTH);
+        if (le32(slot->length) != expected_length)
+            stress_fail("wrong length", round, le32(slot->length));
+        for (size_t i = 0; i < expected_length && i < le32(slot->length); ++i)
+            if (le16(slot->entries[i].score) != total - i)
+                stress_fail("missing score", round, i);
+    }
+    leaderboard_close(&lb);
+
+    const char* files[] = { "leaderboard.bin", "history.bin", "stats.bin", "schedule.bin" };
+    char path[4096 + 32];
+    for (size_t i = 0; i < sizeof files / sizeof files[0]; ++i) {
+        snprintf(path, sizeof path, "%s/%s", dir, files[i]);
+        remove(path);
+    }
+    rmdir(dir);
+
+    if (stress_failed)
+        return EXIT_FAILURE;
+    printf("hexgame: stress passed, %zu writers inserted %zu scores to %zu rounds in %.3f s, %zu reads\n",
+        stress_writers, stress_inserts, STRESS_ROUNDS, seconds, reads);
+    return EXIT_SUCCESS;
+    #endif
+}